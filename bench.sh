@@ -0,0 +1,38 @@
+#!/bin/sh
+# See LICENSE file for copyright and license details.
+#
+# bench.sh - run an instrumented dwm on Xvfb against xstorm scenarios
+#
+# usage: bench.sh [scenario[:iterations] ...]
+#
+# Prints the wall time of every scenario followed by the per event type
+# statistics dwm collected while handling it.
+
+BENCHDISPLAY=${BENCHDISPLAY:-:99}
+SCENARIOS=${*:-map view title status drag hotplug}
+
+command -v Xvfb > /dev/null || { echo "bench.sh: Xvfb not found" >&2; exit 1; }
+
+log=`mktemp`
+Xvfb ${BENCHDISPLAY} -screen 0 1280x1024x24 -nolisten tcp > /dev/null 2>&1 &
+xvfb=$!
+trap 'kill ${dwm} ${xvfb} 2> /dev/null; rm -f ${log}' EXIT
+sleep 1
+
+# appending, so that truncating the log below does not leave dwm writing
+# at its old offset
+DISPLAY=${BENCHDISPLAY} ./dwm-bench 2>> ${log} &
+dwm=$!
+sleep 1
+
+for s in ${SCENARIOS}; do
+	DISPLAY=${BENCHDISPLAY} ./xstorm `echo ${s} | tr ':' ' '` || exit 1
+	# dwm prints and resets its counters after the batch following SIGUSR1
+	: > ${log}
+	kill -USR1 ${dwm}
+	sleep 0.2
+	DISPLAY=${BENCHDISPLAY} ./xstorm status 1 > /dev/null
+	sleep 0.2
+	grep '^dwm:' ${log}
+	echo
+done
@@ -12,6 +12,10 @@ static const unsigned int borderpx  = 1;        /* border pixel of windows */
 static const unsigned int snap      = 32;       /* snap pixel */
 static const Bool showbar           = True;     /* False means no bar */
 static const Bool topbar            = True;     /* False means bottom bar */
+static const unsigned int dragfps   = 60;       /* max move/resize steps per second, 0 means unlimited */
+static const Bool dragoutline       = False;    /* True means drag an outline, resize on release */
+static const unsigned int statusrate = 4;       /* max status text reads per second, 0 means unlimited */
+static const char ipcsocket[]       = "/tmp/dwm-%s.sock"; /* control socket, %s is the display, "" disables it */
 
 /* tagging */
 static const char *tags[ NUMVIEWS ] = { "1", "2", "3", "4", "5", "6", "7", "8", "9" };
@@ -84,6 +88,7 @@ static Key keys[] = {
     TAGKEYS(                        XK_8,                      7)
     TAGKEYS(                        XK_9,                      8)
     { MODKEY|ShiftMask,             XK_q,      quit,           {0} },
+    { MODKEY|ControlMask|ShiftMask, XK_q,      restart,        {0} },
 };
 
 /* button definitions */
@@ -0,0 +1,105 @@
+/* See LICENSE file for copyright and license details. */
+
+/* appearance */
+static const char font[]            = "-misc-fixed-medium-r-normal-*-10-*-*-*-*-*-iso10646-*";
+static const char normbordercolor[] = "#cccccc";
+static const char normbgcolor[]     = "#cccccc";
+static const char normfgcolor[]     = "#000000";
+static const char selbordercolor[]  = "#ff0000";
+static const char selbgcolor[]      = "#0066ff";
+static const char selfgcolor[]      = "#ffffff";
+static const unsigned int borderpx  = 1;        /* border pixel of windows */
+static const unsigned int snap      = 32;       /* snap pixel */
+static const Bool showbar           = True;     /* False means no bar */
+static const Bool topbar            = True;     /* False means bottom bar */
+static const unsigned int dragfps   = 60;       /* max move/resize steps per second, 0 means unlimited */
+static const Bool dragoutline       = False;    /* True means drag an outline, resize on release */
+static const unsigned int statusrate = 4;       /* max status text reads per second, 0 means unlimited */
+static const char ipcsocket[]       = "/tmp/dwm-%s.sock"; /* control socket, %s is the display, "" disables it */
+
+/* tagging */
+static const char *tags[ NUMVIEWS ] = { "1", "2", "3", "4", "5", "6", "7", "8", "9" };
+
+/* layout(s) */
+static const float mfact      = 0.5; /* factor of master area size [0.05..0.95] */
+static const Bool resizehints = False; /* True means respect size hints in tiled resizals */
+
+static const Layout layouts[] = {
+    /* symbol     arrange function */
+    { "[M]",      monocle }, /* first entry is default */
+    { "[]=",      tile },
+    { "=[]",      mirrortile },
+    { "><>",      NULL },    /* no layout function means floating behavior */
+};
+
+static const Rule rules[] = {
+    /* cmd              view    floating */
+    { "Cssh",           0,      True },
+    { "Dolphin",        5,      False },
+    { "Vlc",            6,      False },
+    { "Soffice",        7,      False },
+    { "Thunderbird",    8,      False },
+    { "VirtualBox",     9,      False },
+};
+
+/* key definitions */
+#define MODKEY Mod4Mask
+#define TAGKEYS(KEY,TAG) \
+    { MODKEY,                       KEY,      view,           {.ui = TAG} }, \
+    { MODKEY|ShiftMask,             KEY,      movetoview,     {.ui = TAG} },
+
+/* commands */
+static const char *dmenucmd[] = { "dmenu_run", "-fn", font, "-nb", normbgcolor, "-nf", normfgcolor, "-sb", selbgcolor, "-sf", selfgcolor, NULL };
+static const char *gmruncmd[] = { "gmrun", NULL };
+static const char *termcmd[]  = { "roxterm", NULL };
+
+static Key keys[] = {
+    /* modifier                     key        function        argument */
+    { MODKEY,                       XK_p,      spawn,          {.v = dmenucmd } },
+    { MODKEY|ShiftMask,             XK_p,      spawn,          {.v = gmruncmd } },
+    { MODKEY|ShiftMask,             XK_Return, spawn,          {.v = termcmd } },
+    { MODKEY,                       XK_b,      togglebar,      {0} },
+    { MODKEY,                       XK_j,      focusstack,     {.i = +1 } },
+    { MODKEY|ShiftMask,             XK_j,      movestack,      {.i = +1 } },
+    { MODKEY,                       XK_k,      focusstack,     {.i = -1 } },
+    { MODKEY|ShiftMask,             XK_k,      movestack,      {.i = -1 } },
+    { MODKEY,                       XK_h,      setmfact,       {.f = -0.05} },
+    { MODKEY,                       XK_l,      setmfact,       {.f = +0.05} },
+    { MODKEY,                       XK_Return, zoom,           {0} },
+    { MODKEY|ShiftMask,             XK_c,      killclient,     {0} },
+    { MODKEY,                       XK_m,      setlayout,      {.v = &layouts[0]} },
+    { MODKEY,                       XK_t,      setlayout,      {.v = &layouts[1]} },
+    { MODKEY,                       XK_r,      setlayout,      {.v = &layouts[2]} },
+    { MODKEY,                       XK_f,      setlayout,      {.v = &layouts[3]} },
+    { MODKEY|ShiftMask,             XK_space,  togglefloating, {0} },
+    { MODKEY,                       XK_w,      focusmon,       {.i = -1 } },
+    { MODKEY,                       XK_e,      focusmon,       {.i = +1 } },
+    { MODKEY|ShiftMask,             XK_w,      movetomon,      {.i = -1 } },
+    { MODKEY|ShiftMask,             XK_e,      movetomon,      {.i = +1 } },
+    { MODKEY,                       XK_comma,  incmaster,      {.i = +1 } },
+    { MODKEY,                       XK_period, incmaster,      {.i = -1 } },
+    TAGKEYS(                        XK_1,                      0)
+    TAGKEYS(                        XK_2,                      1)
+    TAGKEYS(                        XK_3,                      2)
+    TAGKEYS(                        XK_4,                      3)
+    TAGKEYS(                        XK_5,                      4)
+    TAGKEYS(                        XK_6,                      5)
+    TAGKEYS(                        XK_7,                      6)
+    TAGKEYS(                        XK_8,                      7)
+    TAGKEYS(                        XK_9,                      8)
+    { MODKEY|ShiftMask,             XK_q,      quit,           {0} },
+    { MODKEY|ControlMask|ShiftMask, XK_q,      restart,        {0} },
+};
+
+/* button definitions */
+/* click can be ClkLtSymbol, ClkStatusText, ClkWinTitle, ClkClientWin, or ClkRootWin */
+static Button buttons[] = {
+    /* click                event mask      button          function        argument */
+    { ClkWinTitle,          0,              Button2,        zoom,           {0} },
+    { ClkClientWin,         MODKEY,         Button1,        movemouse,      {0} },
+    { ClkClientWin,         MODKEY,         Button2,        togglefloating, {0} },
+    { ClkClientWin,         MODKEY,         Button3,        resizemouse,    {0} },
+    { ClkTagBar,            0,              Button1,        view,           {0} },
+};
+
+// vim: expandtab
@@ -14,12 +14,26 @@ X11LIB = /usr/X11R6/lib
 XINERAMALIBS = -L${X11LIB} -lXinerama
 XINERAMAFLAGS = -DXINERAMA
 
+# RandR, uncomment to follow output changes which keep the screen size
+#XRANDRLIBS = -lXrandr
+#XRANDRFLAGS = -DXRANDR
+
+# Xft, uncomment to draw the bar with client side fonts whose glyphs are cached in the server
+#XFTLIBS = -lXft
+#XFTFLAGS = -DXFT -I/usr/include/freetype2
+
+# instrumentation, uncomment to enable per-event statistics (dumped on SIGUSR1)
+#INSTRUMENTFLAGS = -DINSTRUMENT
+
+# low footprint, uncomment to use a single core font and share title buffers
+#LOWMEMFLAGS = -DLOWMEM
+
 # includes and libs
 INCS = -I. -I/usr/include -I${X11INC}
-LIBS = -L/usr/lib -lc -L${X11LIB} -lX11 ${XINERAMALIBS}
+LIBS = -L/usr/lib -lc -L${X11LIB} -lX11 ${XINERAMALIBS} ${XRANDRLIBS} ${XFTLIBS}
 
 # flags
-CPPFLAGS = -DVERSION=\"${VERSION}\" ${XINERAMAFLAGS}
+CPPFLAGS = -DVERSION=\"${VERSION}\" -D_POSIX_C_SOURCE=200809L ${XINERAMAFLAGS} ${XRANDRFLAGS} ${XFTFLAGS} ${INSTRUMENTFLAGS} ${LOWMEMFLAGS}
 CFLAGS = -g -std=c99 -pedantic -Wall -O2 ${INCS} ${CPPFLAGS}
 #CFLAGS = -std=c99 -pedantic -Wall -Os ${INCS} ${CPPFLAGS}
 LDFLAGS = -g ${LIBS} -Xlinker --strip-all
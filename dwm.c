@@ -15,21 +15,32 @@
  * list on a view. Each monitor has 9 views, where each view has its own layout
  * method. The focus history is remembered through a stack list on each view.
  * Each client contains an integer to indicate the view in which it resides.
+ * Clients are additionally indexed by window in a small hash table, so that
+ * mapping an event window to its client does not depend on the client count.
  *
  * Keys are organized as arrays and defined in config.h.
  *
  * To understand everything else, start reading main().
  */
+#define _GNU_SOURCE          /* POSIX_SPAWN_SETSID in glibc's <spawn.h> */
 #include <errno.h>
+#include <fcntl.h>
 #include <locale.h>
+#include <poll.h>
 #include <stdarg.h>
 #include <signal.h>
+#include <spawn.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/un.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <X11/cursorfont.h>
 #include <X11/keysym.h>
 #include <X11/Xatom.h>
@@ -39,11 +50,21 @@
 #ifdef XINERAMA
 #include <X11/extensions/Xinerama.h>
 #endif /* XINERAMA */
+#ifdef XRANDR
+#include <X11/extensions/Xrandr.h>
+#endif /* XRANDR */
+#ifdef XFT
+#include <X11/Xft/Xft.h>
+#endif /* XFT */
 
 /* macros */
 #define BUTTONMASK              (ButtonPressMask|ButtonReleaseMask)
 #define CLEANMASK(mask)         (mask & ~(numlockmask|LockMask))
+#define DRAGFRAME               LASTEvent /* drag event type, a deferred step is due */
+#define DRAGMASK                (MOUSEMASK|ExposureMask|SubstructureRedirectMask)
 #define INRECT(X,Y,RX,RY,RW,RH) ((X) >= (RX) && (X) < (RX) + (RW) && (Y) >= (RY) && (Y) < (RY) + (RH))
+#define INSLAB(S,C)             ( ( char * ) ( C ) >= ( char * ) ( S )->clients \
+                                  && ( char * ) ( C ) < ( char * ) ( ( S )->clients + CLIENTSLAB ) )
 #define ISVISIBLE(C)            ( C->view == C->mon->selview )
 #define LENGTH(X)               ( sizeof( X ) / sizeof( X[ 0 ] ) )
 #define MAX(A, B)               ((A) > (B) ? (A) : (B))
@@ -54,15 +75,66 @@
 #define TEXTW(X)                (textnw(X, strlen(X)) + dc.font.height)
 #define SELVIEW(M)              (M->views[ M->selview ])
 #define NUMVIEWS                9
+#define CLIENTSLAB              64  /* clients allocated at once by allocclient() */
+#ifdef INSTRUMENT
+#define NUMBUCKETS              24  /* latency histogram, bucket i counts [2^i, 2^(i+1)) us */
+#define TRACEATOMS              ( LASTEvent + 1 ) /* trace record, the atoms of the traced dwm */
+#define TRACEMAGIC              "dwmtrc2\n"
+#define TRACEWINDOW             ( LASTEvent + 2 ) /* trace record, a TraceWindow */
+/* count the requests which block until the server replied */
+#define ROUNDTRIP(X)            ( roundtrips++, (X) )
+#define XSync(...)              ROUNDTRIP( XSync( __VA_ARGS__ ) )
+#define XGetWindowAttributes(...) ROUNDTRIP( XGetWindowAttributes( __VA_ARGS__ ) )
+#define XGetWindowProperty(...) ROUNDTRIP( XGetWindowProperty( __VA_ARGS__ ) )
+#define XGetTextProperty(...)   ROUNDTRIP( XGetTextProperty( __VA_ARGS__ ) )
+#define XGetTransientForHint(...) ROUNDTRIP( XGetTransientForHint( __VA_ARGS__ ) )
+#define XGetClassHint(...)      ROUNDTRIP( XGetClassHint( __VA_ARGS__ ) )
+#define XGetWMHints(...)        ROUNDTRIP( XGetWMHints( __VA_ARGS__ ) )
+#define XGetWMNormalHints(...)  ROUNDTRIP( XGetWMNormalHints( __VA_ARGS__ ) )
+#define XGetWMProtocols(...)    ROUNDTRIP( XGetWMProtocols( __VA_ARGS__ ) )
+#define XGetModifierMapping(...) ROUNDTRIP( XGetModifierMapping( __VA_ARGS__ ) )
+#define XQueryPointer(...)      ROUNDTRIP( XQueryPointer( __VA_ARGS__ ) )
+#define XQueryTree(...)         ROUNDTRIP( XQueryTree( __VA_ARGS__ ) )
+#define XGrabPointer(...)       ROUNDTRIP( XGrabPointer( __VA_ARGS__ ) )
+#define XInternAtom(...)        ROUNDTRIP( XInternAtom( __VA_ARGS__ ) )
+#define XInternAtoms(...)       ROUNDTRIP( XInternAtoms( __VA_ARGS__ ) )
+#define XAllocNamedColor(...)   ROUNDTRIP( XAllocNamedColor( __VA_ARGS__ ) )
+#define XLoadQueryFont(...)     ROUNDTRIP( XLoadQueryFont( __VA_ARGS__ ) )
+#define XineramaIsActive(...)   ROUNDTRIP( XineramaIsActive( __VA_ARGS__ ) )
+#define XineramaQueryScreens(...) ROUNDTRIP( XineramaQueryScreens( __VA_ARGS__ ) )
+#define PHASE(N)                phase( N )
+#else
+#define PHASE(N)
+#endif /* INSTRUMENT */
+#define IPCCLIENTS              8   /* control socket connections */
+#define IPCBUFSIZE              4096 /* longest line or transaction on the control socket */
+#define KEYTABLESIZE            256 /* keybinding slots, must be a power of two */
+#define KEYHASH(C,M)            ( ( (C) * 31 + (M) ) & ( KEYTABLESIZE - 1 ) )
+#define RULECACHESIZE           64  /* cached rule results by window class */
+#define TEXTCACHESIZE           32  /* cached text widths */
+#define TITLEHASHSIZE           64  /* interned title buckets with LOWMEM */
+#define WINTABLESIZE            256 /* window index buckets, must be a power of two */
+#define WINHASH(W)              ( ( (W) ^ ( (W) >> 8 ) ) & ( WINTABLESIZE - 1 ) )
 
 /* enums */
 enum { CurNormal, CurResize, CurMove, CurLast };        /* cursor */
 enum { ColBorder, ColFG, ColBG, ColLast };              /* color */
 enum { NetSupported, NetWMName, NetWMState,
        NetWMFullscreen, NetLast };                      /* EWMH atoms */
-enum { WMProtocols, WMDelete, WMState, WMLast };        /* default atoms */
+enum { WMProtocols, WMDelete, WMState, WMRestart, WMLast }; /* default atoms */
 enum { ClkTagBar, ClkLtSymbol, ClkStatusText, ClkWinTitle,
        ClkClientWin, ClkRootWin, ClkLast };             /* clicks */
+enum { GrabNone, GrabUnfocused, GrabFocused };        /* client button grabs */
+enum { DirtyLayout = 1 << 0, DirtyStack = 1 << 1,
+       DirtyBar = 1 << 2 };                             /* deferred monitor work */
+enum { SegLtSymbol = NUMVIEWS, SegStatus, SegTitle,
+       SegLast };                                       /* bar segments, tags first */
+enum { SegSel = 1 << 0, SegOccupied = 1 << 1, SegUrgent = 1 << 2,
+       SegFilled = 1 << 3, SegFloating = 1 << 4,
+       SegDirty = 1 << 5 };                             /* segment state */
+enum { TimerStatus, TimerLast };                        /* timers */
+enum { IpcArgNone, IpcArgView, IpcArgInt, IpcArgFloat,
+       IpcArgLayout };                                  /* control command arguments */
 
 typedef union {
 	int i;
@@ -85,22 +157,62 @@ typedef struct {
 	Bool isfloating;
 } Rule;
 
+typedef struct {
+	float mina, maxa;
+	int basew, baseh, incw, inch, maxw, maxh, minw, minh;
+} SizeHints; /* WM_NORMAL_HINTS as used by applysizehints(), all 0 for none */
+
 typedef struct Monitor Monitor;
 typedef struct Client Client;
 struct Client {
-	char name[256];
-	float mina, maxa;
-	int x, y, w, h;
-	int oldx, oldy, oldw, oldh;
-	int basew, baseh, incw, inch, maxw, maxh, minw, minh;
-	int bw, oldbw;
-	Bool isfixed, isfloating, isurgent, oldstate;
-	Client *next;
-	Client *snext;
+	/* what the layouts and list walks touch, kept within the first 64 bytes */
+	Client *next, *prev;       /* the head's prev is the tail */
+	Client *snext, *sprev;     /* same for the focus stack */
 	Monitor *mon;
+	int x, y, w, h;
 	unsigned int view;
+	Bool isfloating;
+	/* the rest */
+	Client *hnext;
+	Client *pnext;
 	Window win;
+	Window stackbelow;         /* sibling restack() last put it directly below */
+	char *name;                /* title, allocated by setname() */
+	unsigned int namelen, namesize;
+	SizeHints hints;
+	int oldx, oldy, oldw, oldh;
+	int sentx, senty, sentw, senth, sentbw; /* geometry last sent to the server */
+	int bw, oldbw;
+	int grab;
+	Bool isfixed, isurgent, oldstate, ispending, ishidden;
+	Bool titlestale;           /* name is refetched before it is drawn */
+};
+
+typedef struct ClientSlab ClientSlab;
+struct ClientSlab {
+	/* first in the 64 byte aligned slab and rounded up to whole cache
+	 * lines, so that the hot fields of every client share one line */
+	union {
+		Client c;
+		char line[ ( sizeof( Client ) + 63 ) / 64 * 64 ];
+	} clients[ CLIENTSLAB ];
+	ClientSlab *next;
+#ifdef LOWMEM
+	unsigned int used;    /* the slab is freed again when this drops to 0 */
+#endif /* LOWMEM */
 };
+/* compile time checks of the above, the array size is negative if not */
+typedef char clienthotfields[ offsetof( Client, hnext ) <= 64 ? 1 : -1 ];
+typedef char clientslots[ sizeof( ( ( ClientSlab * ) 0 )->clients[ 0 ] ) % 64 == 0 ? 1 : -1 ];
+
+#ifdef LOWMEM
+typedef struct Title Title;
+struct Title {
+	Title *next;
+	unsigned int refs;    /* clients whose name points here */
+	char name[];
+};
+#endif /* LOWMEM */
 
 typedef struct {
 	int x, y, w, h;
@@ -108,12 +220,20 @@ typedef struct {
 	unsigned long sel[ColLast];
 	Drawable drawable;
 	GC gc;
+#ifdef XFT
+	XftDraw *xftdraw;
+	XftColor xftnorm[ColLast];
+	XftColor xftsel[ColLast];
+#endif /* XFT */
 	struct {
 		int ascent;
 		int descent;
 		int height;
 		XFontSet set;
 		XFontStruct *xfont;
+#ifdef XFT
+		XftFont *xft;     /* glyphs are uploaded once into a server side glyphset */
+#endif /* XFT */
 	} font;
 } DC; /* draw context */
 
@@ -124,14 +244,129 @@ typedef struct {
 	const Arg arg;
 } Key;
 
+typedef struct {
+	unsigned int code, mod;  /* keycode and cleaned modifier state */
+	const Key *key;
+} KeyBinding;
+
+typedef struct {
+	int x, y, w, h;
+} Rect;
+
+typedef struct {
+	int bw;
+	SizeHints hints;
+} TiledClient;
+
+typedef struct {
+	Rect area;            /* window area of the monitor */
+	unsigned int n;       /* tiled clients, one rectangle each */
+	unsigned int nall;    /* all clients of the view, floating ones included */
+	unsigned int nmaster;
+	float mfact;
+	char *symbol;         /* layout symbol, may be overridden */
+	size_t symbolsize;
+	const TiledClient *clients; /* one per tiled client, NULL to leave sizes as planned */
+	int minsize;          /* smallest window side, see applysizehints() */
+} Tiling; /* input of a layout, see arrangemon() */
+
 typedef struct {
 	const char *symbol;
-	void (*arrange)(Monitor *);
+	void (*arrange)(const Tiling *t, Rect *r); /* outer geometry, no X requests */
 } Layout;
 
+#ifdef INSTRUMENT
+typedef struct {
+	unsigned long count, roundtrips;
+	unsigned long long total, max; /* nanoseconds */
+	unsigned long buckets[ NUMBUCKETS ];
+} Stats; /* per event type */
+
+typedef struct {
+	unsigned int delta;   /* microseconds since the previous record */
+	unsigned short type;  /* event type, 0 marks the end of an event batch */
+	unsigned short len;   /* bytes of event data following the record */
+} TraceRecord;
+
+enum { TraceRoot, TraceBar, TraceClient, TraceScanned, TraceGone }; /* TraceWindow kinds */
+
+typedef struct {
+	Window win;           /* id in the traced session */
+	unsigned int kind;
+	unsigned int mon;     /* monitor number of a bar */
+	int x, y, w, h, bw;
+	Bool override;
+	Window transient;     /* WM_TRANSIENT_FOR, None if unset */
+	XSizeHints hints;     /* WM_NORMAL_HINTS, flags 0 if unset */
+	char class[64], instance[64], name[256];
+} TraceWindow; /* written when a window is first seen, see recordwindow() */
+
+typedef struct {
+	Window traced, win;   /* id in the traced session and on this display */
+	Bool created;         /* a stand-in made by replaywindow() */
+} StandIn;
+#endif /* INSTRUMENT */
+
+/* state handed from restart() to the next dwm through a root window
+ * property: a StateHeader, nmons MonitorStates, nclients ClientStates in
+ * client list order and then nclients windows in focus stack order */
+typedef struct {
+	long version, nmons, nclients;
+} StateHeader;
+
+typedef struct {
+	long num, selview, showbar;
+	long views[ NUMVIEWS ][ 3 ]; /* nmaster, mfact in 1/10000, layout index */
+} MonitorState;
+
+typedef struct {
+	long win, mon, view, isfloating;
+	long x, y, w, h, bw, oldbw;
+} ClientState;
+
+typedef struct {
+	int fd;               /* -1 for a free slot */
+	Bool subscribed;      /* focus and view changes are streamed to it */
+	Bool dead;            /* closed once the current read is processed */
+	unsigned int len;
+	char buf[ IPCBUFSIZE ];
+} IpcClient; /* control socket connection */
+
+typedef struct {
+	const char *name;
+	void (*func)(const Arg *);
+	unsigned int argtype;
+} IpcCommand;
+
+typedef struct {
+	char class[256];
+	int view;             /* view index, -1 keeps the default view */
+	int isfloating;       /* -1 keeps the default */
+	Bool used;
+} RuleResult; /* what rules[] resolves to for a window class */
+
+typedef struct {
+	void (*func)(void);
+	unsigned long long due; /* monotonic milliseconds, 0 means disarmed */
+} Timer;
+
+typedef struct {
+	char text[256];
+	unsigned int len;
+	int width;
+	unsigned long used;   /* last use for LRU replacement, 0 means empty */
+} TextWidth;
+
+typedef struct {
+	int x, w;             /* geometry inside the bar, w < 0 means invalid */
+	unsigned int state;
+	char text[256];
+} Segment; /* last drawn content of a bar segment */
+
 typedef struct {
 	unsigned int nmaster;
 	float mfact;
+	unsigned int ntiled, nfloating, nurgent; /* maintained by attach() and detach() */
 	Client *clients;
 	Client *sel;
 	Client *stack;
@@ -148,84 +383,146 @@ struct Monitor {
 	Bool topbar;
 	Monitor *next;
 	Window barwin;
+	Client *pending;      /* clients with unflushed geometry */
+	unsigned int dirty;   /* work deferred to the end of the event batch */
+	Segment segs[ SegLast ];
 	unsigned int selview;
+	int shownview;        /* view whose clients are on screen, -1 if unknown */
+	int ipcview;          /* view last announced to subscribers, -1 if none */
 	View views[ NUMVIEWS ];
 };
 
 /* function declarations */
+static Client *allocclient( void );
 static void applyrules( Client *c );
 static Bool applysizehints(Client *c, int *x, int *y, int *w, int *h, Bool interact);
 static void arrange(Monitor *const m);
 static void arrangemon( Monitor *const m );
 static void attach(Client *c);
+static void attachafter( Client *c, Client *p );
 static void attachstack(Client *c);
+static void attachwin( Client *c );
 static void buttonpress( XEvent *e );
 static void checkotherwm(void);
 static void cleanup(void);
 static void cleanupmon(Monitor *mon);
+static void compilerules( void );
+static int cmpstate( const void *a, const void *b );
 static void clearurgent(Client *c);
 static void clientmessage(XEvent *e);
+static void coalesce( XEvent *e );
 static void configure(Client *c);
+static unsigned int configureclient( Client *c );
 static void configurenotify(XEvent *e);
 static void configurerequest( XEvent *e );
 static Monitor *createmon(void);
 static void destroynotify(XEvent *e);
 static void detach( Client *c );
 static void detachstack(Client *c);
+static void detachwin( Client *c );
 static void die(const char *errstr, ...);
 static Monitor *dirtomon(int dir);
+static void dragbegin( Client *c );
+static void dragend( Client *c, Bool apply, int x, int y, int w, int h );
+static void dragevent( XEvent *ev, Bool pending, unsigned long long due );
+static Bool dragframe( XEvent *ev, Time *last, unsigned long long *due );
+static Bool draggrab( Cursor cur );
+static Bool dragorigin( int *x, int *y );
+static void dragstep( Client *c, int x, int y, int w, int h );
 static void drawbar(Monitor *m);
-static void drawbars(void);
+static void drawoutline( void );
+static Bool drawseg( Monitor *m, unsigned int i, int x, int w, unsigned int state, const char *text );
 static void drawsquare(Bool filled, Bool empty, Bool invert, unsigned long col[ColLast]);
 static void drawtext(const char *text, unsigned long col[ColLast], Bool invert);
 static void enternotify( XEvent *e );
 static void expose(XEvent *e);
+static void flushdirty( void );
+static void flushgeom( Monitor *m );
 static void focus(Client *c);
 static void focusin( XEvent *e );
 static void focusmon( const Arg *arg );
 static void focusstack(const Arg *arg);
+static void freeclient( Client *c );
 static unsigned long getcolor(const char *colstr);
 static Bool getrootptr(int *x, int *y);
 static long getstate(Window w);
 static Bool gettextprop(Window w, Atom atom, char *text, unsigned int size);
 static void grabbuttons(Client *c, Bool focused);
 static void grabkeys(void);
-static Bool hasurgentclient( const View *const v );
+static void ignoreenter( void );
+static void handle( XEvent *e );
+static void hintsize( const SizeHints *s, int *w, int *h );
+static void updatebuttongrabs( void );
 static void incmaster(const Arg *arg);
 static void initfont(const char *fontstr);
+static void invalidatebar( Monitor *m );
+static void ipcbroadcast( const char *msg, int len );
+static void ipccleanup( void );
+static void ipcclose( IpcClient *ic );
+static Bool ipcdispatch( struct pollfd *pfd, unsigned int n );
+static void ipcnotify( void );
+static const char *ipcparse( char *line, const IpcCommand **cmd, Arg *arg );
+static unsigned int ipcpollfds( struct pollfd *pfd );
+static Bool ipcread( IpcClient *ic );
+static void ipcreply( IpcClient *ic, const char *msg );
+static void ipcsetup( void );
 static Bool isprotodel(Client *c);
 static void keypress(XEvent *e);
+static Bool latermotion( Display *d, XEvent *e, XPointer arg );
 static void killclient( const Arg *arg );
-static void manage( Window w, XWindowAttributes *wa );
+static void manage( Window w, XWindowAttributes *wa, const ClientState *cs );
 static void mappingnotify(XEvent *e);
+static void matchrules( const char *class, RuleResult *rr );
 static void maprequest(XEvent *e);
-static void mirrortile( Monitor *const m );
-static void monocle( Monitor *const m );
+static void mirrortile( const Tiling *t, Rect *r );
+static void monocle( const Tiling *t, Rect *r );
 static void movemouse( const Arg *arg );
+static unsigned long long monotonic( void );
 static void movestack( const Arg *arg );
 static void movetomon( const Arg *arg );
 static void movetoview(const Arg *arg);
 static Client *nexttiled(Client *c);
 static Monitor *ptrtomon(int x, int y);
-static Client *prevclient( Client *c, Client *head );
 static void propertynotify(XEvent *e);
 static void quit(const Arg *arg);
+static void releasename( Client *c );
 static void resize(Client *c, int x, int y, int w, int h, Bool interact);
 static void resizeclient(Client *c, int x, int y, int w, int h);
 static void resizemouse( const Arg *arg );
 static void restack( Monitor *const m );
+static void restart( const Arg *arg );
+static void restorestate( Window *wins, XWindowAttributes *wa, unsigned int num );
+static Bool samepropev( Display *d, XEvent *e, XPointer arg );
 static void run(void);
+static Bool runtimers( int *timeout );
+static void savestate( void );
 static void scan(void);
 static void sendmon( Client *c, Monitor *m );
 static void setclientstate(Client *c, long state);
+static void setfloating( Client *c, Bool isfloating );
+static void seturgent( Client *c, Bool isurgent );
 static void setlayout( const Arg *arg );
 static void setmfact(const Arg *arg);
+static void setname( Client *c, const char *name );
 static void setup(void);
-static void showhide(Client *c);
+static void showhide( Monitor *m );
 static void sigchld(int unused);
+#ifdef LOWMEM
+static ClientSlab *slabof( Client *c );
+#endif /* LOWMEM */
 static void spawn(const Arg *arg);
+#ifdef XINERAMA
+static void spliceview( Monitor *m, View *dst, View *src );
+#endif /* XINERAMA */
+static int textextents( const char *text, unsigned int len );
 static int textnw(const char *text, unsigned int len);
-static void tile(Monitor *);
+static void tally( Client *c, int d );
+static void tile( const Tiling *t, Rect *r );
+static void tilearea( const Tiling *t, Rect *r, Bool mirror );
+#ifdef LOWMEM
+static unsigned int titlebucket( const char *name );
+#endif /* LOWMEM */
+static unsigned long truecolor( unsigned short v, unsigned long mask );
 static void togglebar(const Arg *arg);
 static void togglefloating( const Arg *arg );
 static void unfocus(Client *c, Bool setfocus);
@@ -234,7 +531,9 @@ static void unmapnotify(XEvent *e);
 static Bool updategeom(void);
 static void updatebarpos(Monitor *m);
 static void updatebars(void);
+static void updatedrawable( void );
 static void updatenumlockmask(void);
+static void updatescreen( int w, int h );
 static void updatesizehints(Client *c);
 static void updatestatus(void);
 static void updatetitle(Client *c);
@@ -245,7 +544,32 @@ static Monitor *wintomon(Window w);
 static int xerror(Display *dpy, XErrorEvent *ee);
 static int xerrordummy(Display *dpy, XErrorEvent *ee);
 static int xerrorstart(Display *dpy, XErrorEvent *ee);
+#ifdef XFT
+static void xftcolor( const char *colstr, XftColor *color );
+#endif /* XFT */
 static void zoom(const Arg *arg);
+#ifdef INSTRUMENT
+static void account( unsigned int type, const struct timespec *start, unsigned long rt );
+static void addstandin( Window traced, Window win, Bool created );
+static void dropstandin( StandIn *s );
+static unsigned long fontbytes( const XFontStruct *f );
+static unsigned long percentile( const Stats *st, unsigned int pct );
+static void phase( const char *name );
+static void printmem( void );
+static void printstats( void );
+static void record( const XEvent *e );
+static void recordstart( void );
+static void recordwindow( Window w, unsigned int kind, unsigned int mon );
+static void replay( const char *path );
+static Atom replayatom( Atom a );
+static int replayevent( XEvent *ev );
+static void replayremap( XEvent *ev );
+static Window replaywin( Window w, Bool need );
+static void replaywindow( const TraceWindow *tw );
+static void sigusr1( int unused );
+static StandIn *standin( Window traced );
+static void tracewrite( unsigned short type, const void *data, unsigned short len );
+#endif /* INSTRUMENT */
 
 /* variables */
 static const char broken[] = "broken";
@@ -253,6 +577,10 @@ static char stext[256];
 static int screen;
 static int sw, sh;           /* X display screen geometry width, height */
 static int bh, blw = 0;      /* bar geometry */
+static int tagw[ NUMVIEWS ]; /* tag cell widths, fixed after setup() */
+static TextWidth textcache[ TEXTCACHESIZE ];
+static RuleResult rulecache[ RULECACHESIZE ];
+static unsigned long textclock = 0;
 static int (*xerrorxlib)(Display *, XErrorEvent *);
 static unsigned int numlockmask = 0;
 static void (*handler[LASTEvent]) (XEvent *) = {
@@ -271,36 +599,171 @@ static void (*handler[LASTEvent]) (XEvent *) = {
 	[UnmapNotify] = unmapnotify
 };
 static Atom wmatom[WMLast], netatom[NetLast];
+static GC outlinegc = NULL;  /* set while an outline drag is in progress */
+static XRectangle outline;
 static Bool otherwm;
+static Bool batchgeom = False; /* True while arrange() queues geometry changes */
+static unsigned long enterserial = 0; /* crossing events up to this serial are ours */
+static Bool holdarrange = False; /* arrange() is left to flushdirty() while True */
+static int ipcfd = -1;       /* listening control socket */
+static char ipcpath[ sizeof( ( ( struct sockaddr_un * ) 0 )->sun_path ) ];
+static IpcClient ipcclients[ IPCCLIENTS ];
+static Window ipcfocus = None; /* focus last announced to subscribers */
+static const IpcCommand ipccommands[] = {
+	/* name             function        argument */
+	{ "view",           view,           IpcArgView },
+	{ "movetoview",     movetoview,     IpcArgView },
+	{ "setlayout",      setlayout,      IpcArgLayout },
+	{ "setmfact",       setmfact,       IpcArgFloat },
+	{ "incmaster",      incmaster,      IpcArgInt },
+	{ "togglefloating", togglefloating, IpcArgNone },
+	{ "focusstack",     focusstack,     IpcArgInt },
+};
 static Bool running = True;
+static Bool restarting = False;
 static Cursor cursor[CurLast];
 static Display *dpy;
 static DC dc;
 static Monitor *mons = NULL, *selmon = NULL;
+static Monitor *lastselmon = NULL; /* selmon when the bars were last flushed */
+static Client *wintable[ WINTABLESIZE ];
+static Timer timers[ TimerLast ] = {
+	[TimerStatus] = { updatestatus, 0 },
+};
+static unsigned long long laststatus = 0; /* when the status was last read */
+static Client *freeclients = NULL; /* unused pool entries, linked through next */
+static ClientSlab *slabs = NULL;
+static int drawablew = 0;    /* width of dc.drawable, the widest bar */
+#ifdef LOWMEM
+static Title *titles[ TITLEHASHSIZE ];
+#endif /* LOWMEM */
 static Window root;
+#ifdef XRANDR
+static int rrevent = -1;     /* first RandR event code, -1 without RandR */
+#endif /* XRANDR */
+#ifdef INSTRUMENT
+static Stats stats[ LASTEvent + 1 ]; /* the last slot accounts flushdirty() */
+static unsigned long roundtrips = 0;
+static volatile sig_atomic_t dumpstats = 0;
+static FILE *trace = NULL;   /* events are recorded here with -r */
+static FILE *replaytrace = NULL; /* events are read from here with -p */
+static StandIn *standins = NULL; /* windows of the trace seen so far */
+static unsigned int nstandins = 0, standinsize = 0;
+static Atom tracedatoms[ WMLast + NetLast ]; /* wmatom and netatom of the traced dwm */
+static struct timespec tracetime;
+static const char *evnames[ LASTEvent + 1 ] = {
+	[ButtonPress] = "ButtonPress",
+	[ClientMessage] = "ClientMessage",
+	[ConfigureRequest] = "ConfigureRequest",
+	[ConfigureNotify] = "ConfigureNotify",
+	[DestroyNotify] = "DestroyNotify",
+	[EnterNotify] = "EnterNotify",
+	[Expose] = "Expose",
+	[FocusIn] = "FocusIn",
+	[KeyPress] = "KeyPress",
+	[MappingNotify] = "MappingNotify",
+	[MapRequest] = "MapRequest",
+	[PropertyNotify] = "PropertyNotify",
+	[UnmapNotify] = "UnmapNotify",
+	[LASTEvent] = "deferred"
+};
+#endif /* INSTRUMENT */
+static KeyBinding keytable[ KEYTABLESIZE ]; /* open addressing, built by grabkeys() */
 
 /* configuration, allows nested code to access above variables */
 #include "config.h"
 
+/* client button grabs with the lock modifier combinations applied */
+static Button clientbuttons[ LENGTH( buttons ) * 4 ];
+static unsigned int nclientbuttons = 0;
+
+/* rules chained by the first byte of their class, built by compilerules() */
+static int rulehead[ 256 ];
+static int rulenext[ LENGTH( rules ) ];
+static size_t rulelen[ LENGTH( rules ) ];
+
 /* function implementations */
+#ifdef INSTRUMENT
 void
-applyrules( Client *c ) {
-	const char *class;
+account( unsigned int type, const struct timespec *start, unsigned long rt ) {
 	unsigned int i;
-	const Rule *r;
+	unsigned long us;
+	unsigned long long ns;
+	struct timespec now;
+	Stats *const st = &stats[ type ];
+
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	ns = ( now.tv_sec - start->tv_sec ) * 1000000000ULL + now.tv_nsec - start->tv_nsec;
+	st->count++;
+	st->roundtrips += roundtrips - rt;
+	st->total += ns;
+	st->max = MAX( st->max, ns );
+	for ( i = 0, us = ns / 1000 ; ( us >>= 1 ) && i < NUMBUCKETS - 1 ; i++ );
+	st->buckets[ i ]++;
+}
+
+void
+addstandin( Window traced, Window win, Bool created ) {
+	if ( nstandins == standinsize ) {
+		standinsize = standinsize ? 2 * standinsize : 64;
+		if ( !( standins = realloc( standins, standinsize * sizeof( StandIn ) ) ) )
+			die( "fatal: could not realloc() %u bytes\n", standinsize * sizeof( StandIn ) );
+	}
+	standins[ nstandins ].traced = traced;
+	standins[ nstandins ].win = win;
+	standins[ nstandins ].created = created;
+	nstandins++;
+}
+#endif /* INSTRUMENT */
+
+Client *
+allocclient( void ) {
+	static Client cz;
+	ClientSlab *slab;
+	Client *c;
+	unsigned int i;
+
+	if ( !freeclients ) {
+		if ( posix_memalign( ( void ** ) &slab, 64, sizeof( ClientSlab ) ) )
+			die( "fatal: could not malloc() %u bytes\n", sizeof( ClientSlab ) );
+		slab->next = slabs;
+		slabs = slab;
+#ifdef LOWMEM
+		slab->used = 0;
+#endif /* LOWMEM */
+		for ( i = 0 ; i < CLIENTSLAB ; i++ ) {
+			slab->clients[ i ].c.next = freeclients;
+			freeclients = &slab->clients[ i ].c;
+		}
+	}
+	c = freeclients;
+	freeclients = c->next;
+	*c = cz;
+#ifdef LOWMEM
+	slabof( c )->used++;
+#endif /* LOWMEM */
+	return c;
+}
+
+void
+applyrules( Client *c ) {
+	const char *class, *s;
+	unsigned int h;
+	RuleResult *rr;
 	XClassHint ch = { 0 };
 
-	/* rule matching */
+	/* rule matching, the result only depends on the class */
 	if ( XGetClassHint( dpy, c->win, &ch ) ) {
 		class = ch.res_class ? ch.res_class : broken;
-		for ( i = 0 ; i < LENGTH( rules ) ; i++ ) {
-			r = &rules[ i ];
-			if ( !r->class || strstr( class, r->class ) ) {
-				c->isfloating = r->isfloating;
-				if ( 0 != r->view )
-					c->view = r->view - 1;
-			}
-		}
+		for ( h = 2166136261U, s = class ; *s ; s++ ) /* FNV-1a */
+			h = ( h ^ ( unsigned char ) *s ) * 16777619U;
+		rr = &rulecache[ h % RULECACHESIZE ];
+		if ( !rr->used || strcmp( rr->class, class ) )
+			matchrules( class, rr );
+		if ( rr->isfloating >= 0 )
+			c->isfloating = rr->isfloating;
+		if ( rr->view >= 0 )
+			c->view = rr->view;
 		if ( ch.res_class )
 			XFree( ch.res_class );
 		if ( ch.res_name )
@@ -310,7 +773,6 @@ applyrules( Client *c ) {
 
 Bool
 applysizehints(Client *c, int *x, int *y, int *w, int *h, Bool interact) {
-	Bool baseismin;
 	Monitor *m = c->mon;
 
 	/* set minimum possible */
@@ -340,52 +802,28 @@ applysizehints(Client *c, int *x, int *y, int *w, int *h, Bool interact) {
 		*h = bh;
 	if(*w < bh)
 		*w = bh;
-	if(resizehints || c->isfloating) {
-		/* see last two sentences in ICCCM 4.1.2.3 */
-		baseismin = c->basew == c->minw && c->baseh == c->minh;
-		if(!baseismin) { /* temporarily remove base dimensions */
-			*w -= c->basew;
-			*h -= c->baseh;
-		}
-		/* adjust for aspect limits */
-		if(c->mina > 0 && c->maxa > 0) {
-			if(c->maxa < (float)*w / *h)
-				*w = *h * c->maxa + 0.5;
-			else if(c->mina < (float)*h / *w)
-				*h = *w * c->mina + 0.5;
-		}
-		if(baseismin) { /* increment calculation requires this */
-			*w -= c->basew;
-			*h -= c->baseh;
-		}
-		/* adjust for increment value */
-		if(c->incw)
-			*w -= *w % c->incw;
-		if(c->inch)
-			*h -= *h % c->inch;
-		/* restore base dimensions */
-		*w += c->basew;
-		*h += c->baseh;
-		*w = MAX(*w, c->minw);
-		*h = MAX(*h, c->minh);
-		if(c->maxw)
-			*w = MIN(*w, c->maxw);
-		if(c->maxh)
-			*h = MIN(*h, c->maxh);
-	}
+	if(resizehints || c->isfloating)
+		hintsize(&c->hints, w, h);
 	return *x != c->x || *y != c->y || *w != c->w || *h != c->h;
 }
 
 void
 arrange( Monitor *m ) {
-	int i;
+	if ( holdarrange ) { /* a control socket batch, arranged once by flushdirty() */
+		if ( m )
+			m->dirty |= DirtyLayout;
+		else for ( m = mons ; m ; m = m->next )
+			m->dirty |= DirtyLayout;
+		return;
+	}
 
+	/* layouts only compute geometry here, the X requests are issued by
+	 * flushgeom() at the end */
+	batchgeom = True;
 	if ( m )
-		for ( i = 0 ; i < NUMVIEWS ; i++ )
-			showhide( m->views[ i ].stack );
+		showhide( m );
 	else for( m = mons ; m ; m = m->next )
-		for ( i = 0 ; i < NUMVIEWS ; i++ )
-			showhide( m->views[ i ].stack );
+		showhide( m );
 
 	focus( NULL );
 
@@ -393,26 +831,107 @@ arrange( Monitor *m ) {
 		arrangemon( m );
 	else for( m = mons ; m ; m = m->next )
 		arrangemon( m );
+	batchgeom = False;
+
+	for( m = mons ; m ; m = m->next )
+		flushgeom( m );
+	ignoreenter();
 }
 
 void
 arrangemon( Monitor *const m ) {
-	strncpy( m->ltsymbol, SELVIEW( m ).lt->symbol, sizeof( m->ltsymbol ) );
-	if ( SELVIEW( m ).lt->arrange )
-		SELVIEW( m ).lt->arrange( m );
+	static Rect *rects = NULL;
+	static TiledClient *tiled = NULL;
+	static unsigned int nrects = 0;
+	static const SizeHints nohints;
+	View *const v = &SELVIEW( m );
+	unsigned int i;
+	Client *c;
+	Tiling t;
+
+	strncpy( m->ltsymbol, v->lt->symbol, sizeof( m->ltsymbol ) );
+	if ( v->lt->arrange ) {
+		if ( nrects < v->ntiled ) {
+			nrects = v->ntiled;
+			if ( !( rects = realloc( rects, nrects * sizeof( Rect ) ) ) )
+				die( "fatal: could not realloc() %u bytes\n", nrects * sizeof( Rect ) );
+			if ( !( tiled = realloc( tiled, nrects * sizeof( TiledClient ) ) ) )
+				die( "fatal: could not realloc() %u bytes\n", nrects * sizeof( TiledClient ) );
+		}
+		/* what resize() will apply, so that the layout can place each
+		 * client after the size the previous one really gets */
+		for ( i = 0, c = nexttiled( v->clients ) ; c ; c = nexttiled( c->next ), i++ ) {
+			tiled[ i ].bw = c->bw;
+			tiled[ i ].hints = resizehints ? c->hints : nohints;
+		}
+		t.area.x = m->wx;
+		t.area.y = m->wy;
+		t.area.w = m->ww;
+		t.area.h = m->wh;
+		t.n = v->ntiled;
+		t.nall = v->ntiled + v->nfloating;
+		t.nmaster = v->nmaster;
+		t.mfact = v->mfact;
+		t.symbol = m->ltsymbol;
+		t.symbolsize = sizeof( m->ltsymbol );
+		t.clients = tiled;
+		t.minsize = bh;
+		v->lt->arrange( &t, rects );
+		/* resize() only queues the geometry while arrange() batches */
+		for ( i = 0, c = nexttiled( v->clients ) ; c ; c = nexttiled( c->next ), i++ )
+			resize( c, rects[ i ].x, rects[ i ].y, rects[ i ].w - 2 * c->bw, rects[ i ].h - 2 * c->bw, False );
+	}
 	restack( m );
 }
 
 void
 attach(Client *c) {
-	c->next = c->mon->views[ c->view ].clients;
-	c->mon->views[ c->view ].clients = c;
+	Client **head = &c->mon->views[ c->view ].clients;
+
+	c->next = *head;
+	c->prev = *head ? ( *head )->prev : c;
+	if ( *head )
+		( *head )->prev = c;
+	*head = c;
+	tally( c, +1 );
+}
+
+void
+attachafter( Client *c, Client *p ) {
+	Client *head;
+
+	if ( !p ) {
+		attach( c );
+		return;
+	}
+	head = c->mon->views[ c->view ].clients;
+	c->prev = p;
+	c->next = p->next;
+	if ( p->next )
+		p->next->prev = c;
+	else
+		head->prev = c;
+	p->next = c;
+	tally( c, +1 );
 }
 
 void
 attachstack(Client *c) {
-	c->snext = c->mon->views[ c->view ].stack;
-	c->mon->views[ c->view ].stack = c;
+	Client **head = &c->mon->views[ c->view ].stack;
+
+	c->snext = *head;
+	c->sprev = *head ? ( *head )->sprev : c;
+	if ( *head )
+		( *head )->sprev = c;
+	*head = c;
+}
+
+void
+attachwin( Client *c ) {
+	Client **head = &wintable[ WINHASH( c->win ) ];
+
+	c->hnext = *head;
+	*head = c;
 }
 
 void
@@ -433,7 +952,7 @@ buttonpress( XEvent *e ) {
 	if ( ev->window == selmon->barwin ) {
 		i = x = 0;
 		do {
-			x += TEXTW( tags[ i ] );
+			x += tagw[ i ];
 		} while( ev->x >= x && ++i < NUMVIEWS );
 		if ( i < NUMVIEWS ) {
 			click = ClkTagBar;
@@ -480,10 +999,19 @@ cleanup(void) {
 		for ( i = 0 ; i < NUMVIEWS ; i++ )
 			while ( m->views[ i ].clients )
 				unmanage( m->views[ i ].clients, False );
+#ifdef XFT
+	for ( i = 0 ; i < ColLast ; i++ ) {
+		XftColorFree( dpy, DefaultVisual( dpy, screen ), DefaultColormap( dpy, screen ), &dc.xftnorm[ i ] );
+		XftColorFree( dpy, DefaultVisual( dpy, screen ), DefaultColormap( dpy, screen ), &dc.xftsel[ i ] );
+	}
+	XftDrawDestroy( dc.xftdraw );
+	XftFontClose( dpy, dc.font.xft );
+#else
 	if ( dc.font.set )
 		XFreeFontSet( dpy, dc.font.set );
 	else
 		XFreeFont( dpy, dc.font.xfont );
+#endif /* XFT */
 	XUngrabKey( dpy, AnyKey, AnyModifier, root );
 	XFreePixmap( dpy, dc.drawable );
 	XFreeGC( dpy, dc.gc );
@@ -492,6 +1020,14 @@ cleanup(void) {
 	XFreeCursor( dpy, cursor[ CurMove ] );
 	while ( mons )
 		cleanupmon( mons );
+	while ( slabs ) {
+		ClientSlab *slab = slabs;
+
+		slabs = slab->next;
+		free( slab );
+	}
+	freeclients = NULL;
+	ipccleanup();
 	XSync( dpy, False );
 	XSetInputFocus( dpy, PointerRoot, RevertToPointerRoot, CurrentTime );
 }
@@ -515,7 +1051,7 @@ void
 clearurgent(Client *c) {
 	XWMHints *wmh;
 
-	c->isurgent = False;
+	seturgent(c, False);
 	if(!(wmh = XGetWMHints(dpy, c->win)))
 		return;
 	wmh->flags &= ~XUrgencyHint;
@@ -523,6 +1059,44 @@ clearurgent(Client *c) {
 	XFree(wmh);
 }
 
+void
+coalesce( XEvent *e ) {
+	XEvent dup;
+
+	switch ( e->type ) {
+	case PropertyNotify: /* handlers re-read the property, later duplicates are redundant */
+		while ( XCheckIfEvent( dpy, &dup, samepropev, ( XPointer ) e ) );
+		break;
+	case Expose: /* only bar windows select for exposure, they are redrawn as a whole */
+		while ( XCheckTypedWindowEvent( dpy, e->xexpose.window, Expose, &dup ) );
+		e->xexpose.count = 0;
+		break;
+	}
+}
+
+int
+cmpstate( const void *a, const void *b ) {
+	const Window wa = ( *( const ClientState ** ) a )->win, wb = ( *( const ClientState ** ) b )->win;
+
+	return wa < wb ? -1 : wa > wb;
+}
+
+void
+compilerules( void ) {
+	int i;
+
+	/* walking the chains front to back visits rules in config order */
+	for ( i = 0 ; i < 256 ; i++ )
+		rulehead[ i ] = -1;
+	for ( i = LENGTH( rules ) - 1 ; i >= 0 ; i-- ) {
+		rulelen[ i ] = rules[ i ].class ? strlen( rules[ i ].class ) : 0;
+		if ( rulelen[ i ] ) {
+			rulenext[ i ] = rulehead[ ( unsigned char ) rules[ i ].class[ 0 ] ];
+			rulehead[ ( unsigned char ) rules[ i ].class[ 0 ] ] = i;
+		}
+	}
+}
+
 void
 configure(Client *c) {
 	XConfigureEvent ce;
@@ -541,24 +1115,43 @@ configure(Client *c) {
 	XSendEvent(dpy, c->win, False, StructureNotifyMask, (XEvent *)&ce);
 }
 
+unsigned int
+configureclient( Client *c ) {
+	XWindowChanges wc;
+	unsigned int mask = 0;
+
+	/* send what changed only. A resize or a new border width makes the
+	 * server send a real ConfigureNotify, a pure move gets the synthetic
+	 * one ICCCM 4.1.5 asks for. */
+	if ( c->x != c->sentx )
+		mask |= CWX;
+	if ( c->y != c->senty )
+		mask |= CWY;
+	if ( c->w != c->sentw )
+		mask |= CWWidth;
+	if ( c->h != c->senth )
+		mask |= CWHeight;
+	if ( c->bw != c->sentbw )
+		mask |= CWBorderWidth;
+	if ( !mask )
+		return 0;
+	wc.x = c->sentx = c->x;
+	wc.y = c->senty = c->y;
+	wc.width = c->sentw = c->w;
+	wc.height = c->senth = c->h;
+	wc.border_width = c->sentbw = c->bw;
+	XConfigureWindow( dpy, c->win, mask, &wc );
+	if ( !( mask & ( CWWidth | CWHeight | CWBorderWidth ) ) )
+		configure( c );
+	return mask;
+}
+
 void
 configurenotify(XEvent *e) {
-	Monitor *m;
 	XConfigureEvent *ev = &e->xconfigure;
 
-	if(ev->window == root) {
-		sw = ev->width;
-		sh = ev->height;
-		if(updategeom()) {
-			if(dc.drawable != 0)
-				XFreePixmap(dpy, dc.drawable);
-			dc.drawable = XCreatePixmap(dpy, root, sw, bh, DefaultDepth(dpy, screen));
-			updatebars();
-			for(m = mons; m; m = m->next)
-				XMoveResizeWindow(dpy, m->barwin, m->wx, m->by, m->ww, bh);
-			arrange(NULL);
-		}
-	}
+	if(ev->window == root)
+		updatescreen(ev->width, ev->height);
 }
 
 void
@@ -585,10 +1178,10 @@ configurerequest( XEvent *e ) {
 				c->x = m->mx + ( m->mw / 2 - c->w / 2 ); /* center in x direction */
 			if ( ( c->y + c->h ) > m->my + m->mh && c->isfloating )
 				c->y = m->my + ( m->mh / 2 - c->h / 2 ); /* center in y direction */
-			if ( ( ev->value_mask & ( CWX | CWY ) ) && !( ev->value_mask & ( CWWidth | CWHeight ) ) )
+			/* every request is answered, by the real ConfigureNotify of a
+			 * resize or by a synthetic one */
+			if ( !ISVISIBLE( c ) || !configureclient( c ) )
 				configure( c );
-			if ( ISVISIBLE( c ) )
-				XMoveResizeWindow( dpy, c->win, c->x, c->y, c->w, c->h );
 		}
 		else
 			configure( c );
@@ -615,12 +1208,15 @@ createmon(void) {
 		die( "fatal: could not calloc() %u bytes\n", sizeof( Monitor ) );
 	m->showbar = showbar;
 	m->topbar = topbar;
+	m->shownview = -1;
+	m->ipcview = -1;
 	strncpy( m->ltsymbol, layouts[ 0 ].symbol, sizeof( m->ltsymbol ) );
 	for ( i = 0 ; i < NUMVIEWS ; i++ ) {
 		m->views[ i ].nmaster = 1;
 		m->views[ i ].mfact = mfact;
 		m->views[ i ].lt = &layouts[ 0 ];
 	}
+	invalidatebar( m );
 
 	return m;
 }
@@ -636,18 +1232,33 @@ destroynotify(XEvent *e) {
 
 void
 detach( Client *c ) {
-	Client **tc;
+	Client **head = &c->mon->views[ c->view ].clients;
 
-	for ( tc = &c->mon->views[ c->view ].clients ; *tc != c ; tc = &( *tc )->next );
-	*tc = c->next;
+	if ( c == *head )
+		*head = c->next;
+	else
+		c->prev->next = c->next;
+	if ( c->next )
+		c->next->prev = c->prev;
+	else if ( *head )
+		( *head )->prev = c->prev;
+	c->next = c->prev = NULL;
+	tally( c, -1 );
 }
 
 void
 detachstack( Client *c ) {
-	Client **tc, *t;
+	Client **head = &c->mon->views[ c->view ].stack, *t;
 
-	for ( tc = &c->mon->views[ c->view ].stack ; *tc != c ; tc = &( *tc )->snext );
-	*tc = c->snext;
+	if ( c == *head )
+		*head = c->snext;
+	else
+		c->sprev->snext = c->snext;
+	if ( c->snext )
+		c->snext->sprev = c->sprev;
+	else if ( *head )
+		( *head )->sprev = c->sprev;
+	c->snext = c->sprev = NULL;
 
 	if ( c == c->mon->views[ c->view ].sel ) {
 		for ( t = c->mon->views[ c->view ].stack ; t && !ISVISIBLE( t ) ; t = t->snext );
@@ -655,6 +1266,15 @@ detachstack( Client *c ) {
 	}
 }
 
+void
+detachwin( Client *c ) {
+	Client **tc;
+
+	for ( tc = &wintable[ WINHASH( c->win ) ] ; *tc && *tc != c ; tc = &( *tc )->hnext );
+	if ( *tc )
+		*tc = c->hnext;
+}
+
 void
 die(const char *errstr, ...) {
 	va_list ap;
@@ -684,69 +1304,245 @@ dirtomon(int dir) {
 
 void
 drawbar(Monitor *m) {
-	int x;
-	Bool occ, urg;
-	unsigned int i;
+	int x, w;
+	unsigned int i, state;
 	unsigned long *col;
+	Client *const sel = SELVIEW( m ).sel;
+
+	/* every segment is compared against what was drawn last time, only
+	 * changed ones are repainted and copied to the bar window */
 
 	// view tags
 
-	dc.x = 0;
+	x = 0;
 	for ( i = 0 ; i < NUMVIEWS ; i++ ) {
-		dc.w = TEXTW( tags[ i ] );
-		col = ( i == m->selview ) ? dc.sel : dc.norm;
-		occ = ( NULL != m->views[ i ].clients );
-		urg = hasurgentclient( &m->views[ i ] );
-		drawtext( tags[ i ], col, urg );
-		drawsquare( m == selmon && m->views[ i ].sel && i == m->selview,
-			occ, urg, col );
-		dc.x += dc.w;
+		w = tagw[ i ];
+		state = ( i == m->selview ? SegSel : 0 )
+			| ( m->views[ i ].clients ? SegOccupied : 0 )
+			| ( m->views[ i ].nurgent ? SegUrgent : 0 )
+			| ( m == selmon && m->views[ i ].sel && i == m->selview ? SegFilled : 0 );
+		if ( drawseg( m, i, x, w, state, tags[ i ] ) ) {
+			col = ( state & SegSel ) ? dc.sel : dc.norm;
+			drawtext( tags[ i ], col, state & SegUrgent );
+			drawsquare( state & SegFilled, state & SegOccupied, state & SegUrgent, col );
+		}
+		x += w;
 	}
 
 	// layout name of selected view
 
-	dc.w = blw = TEXTW( m->ltsymbol );
-	drawtext( m->ltsymbol, dc.norm, False );
-	dc.x += dc.w;
+	w = blw = TEXTW( m->ltsymbol );
+	if ( drawseg( m, SegLtSymbol, x, w, 0, m->ltsymbol ) )
+		drawtext( m->ltsymbol, dc.norm, False );
+	x += w;
 
 	// status
 
-	x = dc.x;
 	if ( m == selmon ) { /* status is only drawn on selected monitor */
-		dc.w = TEXTW( stext );
-		dc.x = m->ww - dc.w;
-		if ( !( x <= dc.x ) ) {
-			dc.x = x;
-			dc.w = m->ww - x;
-		}
-		drawtext( stext, dc.norm, False );
+		w = TEXTW( stext );
+		if ( m->ww - w < x )
+			w = m->ww - x;
 	}
 	else
-		dc.x = m->ww;
+		w = 0;
+	if ( drawseg( m, SegStatus, m->ww - w, w, 0, stext ) && w > 0 )
+		drawtext( stext, dc.norm, False );
 
 	// name of selected client of selected view
 
-	if ( ( dc.w = dc.x - x ) > bh ) {
-		dc.x = x;
-		if ( SELVIEW( m ).sel ) {
-			col = ( m == selmon ) ? dc.sel : dc.norm;
-			drawtext( SELVIEW( m ).sel->name, col, False );
-			drawsquare( SELVIEW( m ).sel->isfixed, SELVIEW( m ).sel->isfloating, False, col );
+	w = m->ww - w - x;
+	state = ( m == selmon ? SegSel : 0 ) | ( sel ? SegOccupied : 0 )
+		| ( sel && sel->isfixed ? SegFilled : 0 ) | ( sel && sel->isfloating ? SegFloating : 0 );
+	if ( sel && sel->titlestale )
+		updatetitle( sel );
+	if ( drawseg( m, SegTitle, x, w, state, sel && w > bh ? sel->name : NULL ) && w > 0 ) {
+		col = ( state & SegSel ) ? dc.sel : dc.norm;
+		if ( sel && w > bh ) {
+			drawtext( sel->name, col, False );
+			drawsquare( state & SegFilled, state & SegFloating, False, col );
 		}
 		else
 			drawtext( NULL, dc.norm, False );
 	}
 
-	XCopyArea( dpy, dc.drawable, m->barwin, dc.gc, 0, 0, m->ww, bh, 0, 0 );
-	XSync( dpy, False );
+	for ( i = 0 ; i < SegLast ; i++ )
+		if ( m->segs[ i ].state & SegDirty ) {
+			m->segs[ i ].state &= ~SegDirty;
+			if ( m->segs[ i ].w > 0 )
+				XCopyArea( dpy, dc.drawable, m->barwin, dc.gc,
+					m->segs[ i ].x, 0, m->segs[ i ].w, bh, m->segs[ i ].x, 0 );
+		}
+}
+
+Bool
+drawseg( Monitor *m, unsigned int i, int x, int w, unsigned int state, const char *text ) {
+	Segment *const seg = &m->segs[ i ];
+
+	if ( !text )
+		text = "";
+	if ( seg->x == x && seg->w == w && seg->state == state && !strcmp( seg->text, text ) )
+		return False;
+	seg->x = dc.x = x;
+	seg->w = dc.w = w;
+	seg->state = state | SegDirty;
+	strncpy( seg->text, text, sizeof( seg->text ) - 1 );
+	seg->text[ sizeof( seg->text ) - 1 ] = '\0';
+	return True;
 }
 
 void
-drawbars(void) {
-	Monitor *m;
+dragbegin( Client *c ) {
+	XGCValues gcv;
 
-	for ( m = mons ; m ; m = m->next )
-		drawbar( m );
+	if ( !dragoutline )
+		return;
+	/* the outline is xor-ed onto the root window, keep everybody else
+	 * from drawing underneath it */
+	XGrabServer( dpy );
+	gcv.function = GXxor;
+	gcv.foreground = dc.sel[ ColBorder ] ^ dc.norm[ ColBG ];
+	gcv.subwindow_mode = IncludeInferiors;
+	gcv.line_width = MAX( 1, borderpx );
+	outlinegc = XCreateGC( dpy, root, GCFunction | GCForeground | GCSubwindowMode | GCLineWidth, &gcv );
+	outline.x = c->x;
+	outline.y = c->y;
+	outline.width = WIDTH( c ) - 1;
+	outline.height = HEIGHT( c ) - 1;
+	drawoutline();
+}
+
+void
+dragend( Client *c, Bool apply, int x, int y, int w, int h ) {
+	if ( outlinegc ) {
+		drawoutline();
+		XFreeGC( dpy, outlinegc );
+		outlinegc = NULL;
+		XUngrabServer( dpy );
+	}
+	if ( apply ) /* the last step was skipped or only outlined */
+		resize( c, x, y, w, h, True );
+}
+
+void
+dragevent( XEvent *ev, Bool pending, unsigned long long due ) {
+	Bool released;
+	XEvent next;
+	struct pollfd pfd;
+	unsigned long long now;
+
+#ifdef INSTRUMENT
+	/* a replayed drag continues with the events recorded below, the end
+	 * of a truncated trace releases the button */
+	if ( replaytrace ) {
+		if ( replayevent( ev ) <= 0 ) {
+			memset( ev, 0, sizeof( *ev ) );
+			ev->type = ButtonRelease;
+		}
+		return;
+	}
+#endif /* INSTRUMENT */
+	/* a deferred step is applied when its frame is due, even if the
+	 * pointer stopped moving */
+	pfd.fd = ConnectionNumber( dpy );
+	pfd.events = POLLIN;
+	while ( !XCheckMaskEvent( dpy, DRAGMASK, ev ) ) {
+		if ( !pending ) {
+			XMaskEvent( dpy, DRAGMASK, ev );
+			break;
+		}
+		if ( ( now = monotonic() ) >= due || !poll( &pfd, 1, due - now ) ) {
+			memset( ev, 0, sizeof( *ev ) );
+			ev->type = DRAGFRAME;
+			break;
+		}
+	}
+	/* skip to the latest motion queued before the button release */
+	if ( ev->type == MotionNotify )
+		for ( ;; ) {
+			released = False;
+			if ( !XCheckIfEvent( dpy, &next, latermotion, ( XPointer ) &released ) )
+				break;
+			*ev = next;
+		}
+#ifdef INSTRUMENT
+	if ( trace )
+		record( ev );
+#endif /* INSTRUMENT */
+}
+
+Bool
+dragframe( XEvent *ev, Time *last, unsigned long long *due ) {
+	if ( dragfps && ev->xmotion.time - *last < 1000 / dragfps ) {
+		*due = monotonic() + 1000 / dragfps - ( ev->xmotion.time - *last );
+		return False;
+	}
+	*last = ev->xmotion.time;
+	return True;
+}
+
+Bool
+draggrab( Cursor cur ) {
+#ifdef INSTRUMENT
+	if ( replaytrace ) /* the pointer is not needed, the drag is in the trace */
+		return True;
+#endif /* INSTRUMENT */
+	return XGrabPointer( dpy, root, False, MOUSEMASK, GrabModeAsync, GrabModeAsync,
+		None, cur, CurrentTime ) == GrabSuccess;
+}
+
+Bool
+dragorigin( int *x, int *y ) {
+#ifdef INSTRUMENT
+	XEvent ev;
+	long pos;
+
+	/* the pointer position is stored as a sent MotionNotify, which real
+	 * pointer motion never is */
+	if ( replaytrace ) {
+		pos = ftell( replaytrace );
+		if ( replayevent( &ev ) != MotionNotify || !ev.xmotion.send_event ) {
+			fseek( replaytrace, pos, SEEK_SET ); /* the grab had failed */
+			return False;
+		}
+		*x = ev.xmotion.x;
+		*y = ev.xmotion.y;
+		return True;
+	}
+#endif /* INSTRUMENT */
+	if ( !getrootptr( x, y ) )
+		return False;
+#ifdef INSTRUMENT
+	if ( trace ) {
+		memset( &ev, 0, sizeof( ev ) );
+		ev.type = MotionNotify;
+		ev.xmotion.send_event = True;
+		ev.xmotion.window = root;
+		ev.xmotion.x = *x;
+		ev.xmotion.y = *y;
+		record( &ev );
+	}
+#endif /* INSTRUMENT */
+	return True;
+}
+
+void
+dragstep( Client *c, int x, int y, int w, int h ) {
+	if ( !outlinegc ) {
+		resize( c, x, y, w, h, True );
+		return;
+	}
+	drawoutline();
+	outline.x = x;
+	outline.y = y;
+	outline.width = w + 2 * c->bw - 1;
+	outline.height = h + 2 * c->bw - 1;
+	drawoutline();
+}
+
+void
+drawoutline( void ) {
+	if ( outlinegc )
+		XDrawRectangles( dpy, root, outlinegc, &outline, 1 );
 }
 
 void
@@ -773,7 +1569,10 @@ drawsquare(Bool filled, Bool empty, Bool invert, unsigned long col[ColLast]) {
 void
 drawtext(const char *text, unsigned long col[ColLast], Bool invert) {
 	char buf[256];
-	int i, x, y, h, len, olen;
+	int i, x, y, h, len, olen, lo, hi;
+#ifdef XFT
+	int d;
+#endif /* XFT */
 	XRectangle r = { dc.x, dc.y, dc.w, dc.h };
 
 	XSetForeground(dpy, dc.gc, col[invert ? ColFG : ColBG]);
@@ -784,20 +1583,61 @@ drawtext(const char *text, unsigned long col[ColLast], Bool invert) {
 	h = dc.font.ascent + dc.font.descent;
 	y = dc.y + (dc.h / 2) - (h / 2) + dc.font.ascent;
 	x = dc.x + (h / 2);
-	/* shorten text if necessary */
-	for(len = MIN(olen, sizeof( buf )); len && textnw(text, len) > dc.w - h; len--);
+	/* shorten text if necessary, prefix widths are monotonic so search for
+	 * the longest one that fits; probes bypass the cache */
+	len = MIN(olen, sizeof( buf ));
+	if(textnw(text, len) > dc.w - h) {
+		for(lo = 0, hi = len - 1; lo < hi; ) {
+			i = (lo + hi + 1) / 2;
+			if(textextents(text, i) > dc.w - h)
+				hi = i - 1;
+			else
+				lo = i;
+		}
+		len = lo;
+	}
 	if(!len)
 		return;
+#ifdef XFT
+	if(len < olen) {
+		/* the dots follow the last whole character before them, Xft
+		 * stops drawing at a broken UTF-8 sequence */
+		d = MIN(len, 3);
+		for(i = len - d; i && (text[i] & 0xc0) == 0x80; i--);
+		memcpy(buf, text, i);
+		memset(buf + i, '.', d);
+		while(i && textextents(buf, i + d) > dc.w - h) {
+			while(--i && (text[i] & 0xc0) == 0x80);
+			memset(buf + i, '.', d);
+		}
+		len = i + d;
+	}
+	else
+		memcpy(buf, text, len);
+#else
 	memcpy(buf, text, len);
 	if(len < olen)
 		for(i = len; i && i > len - 3; buf[--i] = '.');
+#endif /* XFT */
+#ifdef XFT
+	XftDrawStringUtf8(dc.xftdraw, (col == dc.sel ? dc.xftsel : dc.xftnorm) + (invert ? ColBG : ColFG),
+	                  dc.font.xft, x, y, (const FcChar8 *)buf, len);
+#else
 	XSetForeground(dpy, dc.gc, col[invert ? ColBG : ColFG]);
 	if(dc.font.set)
 		XmbDrawString(dpy, dc.drawable, dc.font.set, dc.gc, x, y, buf, len);
 	else
 		XDrawString(dpy, dc.drawable, dc.gc, x, y, buf, len);
+#endif /* XFT */
 }
 
+#ifdef INSTRUMENT
+void
+dropstandin( StandIn *s ) {
+	*s = standins[ --nstandins ];
+}
+#endif /* INSTRUMENT */
+
 void
 enternotify( XEvent *e ) {
 	Client *c;
@@ -821,8 +1661,55 @@ expose(XEvent *e) {
 	Monitor *m;
 	XExposeEvent *ev = &e->xexpose;
 
-	if(ev->count == 0 && (m = wintomon(ev->window)))
-		drawbar(m);
+	if(ev->count == 0 && (m = wintomon(ev->window))) {
+		invalidatebar(m);
+		m->dirty |= DirtyBar;
+	}
+}
+
+void
+flushdirty( void ) {
+	Monitor *m;
+#ifdef INSTRUMENT
+	struct timespec t;
+	const unsigned long rt = roundtrips;
+
+	clock_gettime( CLOCK_MONOTONIC, &t );
+#endif /* INSTRUMENT */
+
+	/* layouts first, they restack and mark bars of their own */
+	for ( m = mons ; m ; m = m->next )
+		if ( m->dirty & DirtyLayout ) {
+			m->dirty &= ~( DirtyLayout | DirtyStack );
+			arrange( m );
+		}
+	for ( m = mons ; m ; m = m->next )
+		if ( m->dirty & DirtyStack ) {
+			m->dirty &= ~DirtyStack;
+			restack( m );
+		}
+	/* both bars change when another monitor got selected */
+	for ( m = mons ; m ; m = m->next ) {
+		if ( ( m->dirty & DirtyBar ) || ( selmon != lastselmon && ( m == selmon || m == lastselmon ) ) )
+			drawbar( m );
+		m->dirty = 0;
+	}
+	lastselmon = selmon;
+	ipcnotify();
+#ifdef INSTRUMENT
+	account( LASTEvent, &t, rt );
+#endif /* INSTRUMENT */
+}
+
+void
+flushgeom( Monitor *m ) {
+	Client *c;
+
+	for ( c = m->pending ; c ; c = c->pnext ) {
+		c->ispending = False;
+		configureclient( c );
+	}
+	m->pending = NULL;
 }
 
 void
@@ -845,7 +1732,7 @@ focus( Client *c ) {
 	else
 		XSetInputFocus( dpy, root, RevertToPointerRoot, CurrentTime );
 	SELVIEW( selmon ).sel = c;
-	drawbars();
+	selmon->dirty |= DirtyBar;
 }
 
 void
@@ -869,7 +1756,7 @@ focusmon( const Arg *arg ) {
 
 void
 focusstack(const Arg *arg) {
-	Client *c = NULL, *i;
+	Client *c = NULL;
 
 	if ( SELVIEW( selmon ).sel ) {
 		if ( arg->i > 0 ) {
@@ -877,25 +1764,53 @@ focusstack(const Arg *arg) {
 			if ( !c )
 				c = SELVIEW( selmon ).clients;
 		}
-		else {
-			for ( i = SELVIEW( selmon ).clients ; i != SELVIEW( selmon ).sel ; i = i->next )
-				c = i;
-			if ( !c )
-				for ( ; i ; i = i->next )
-					c = i;
-		}
+		else
+			c = SELVIEW( selmon ).sel->prev;
 		if ( c ) {
 			focus( c );
-			restack( selmon );
+			selmon->dirty |= DirtyStack;
 		}
 	}
 }
 
+void
+freeclient( Client *c ) {
+#ifdef LOWMEM
+	ClientSlab *slab = slabof( c ), **sp;
+	Client **cp;
+#endif /* LOWMEM */
+
+	releasename( c );
+	c->next = freeclients;
+	freeclients = c;
+#ifdef LOWMEM
+	/* give an empty slab back unless it is the last one, a view or
+	 * monitor which lost its clients leaves nothing allocated behind */
+	if ( --slab->used || ( slabs == slab && !slab->next ) )
+		return;
+	for ( cp = &freeclients ; *cp ; )
+		if ( INSLAB( slab, *cp ) )
+			*cp = ( *cp )->next;
+		else
+			cp = &( *cp )->next;
+	for ( sp = &slabs ; *sp != slab ; sp = &( *sp )->next );
+	*sp = slab->next;
+	free( slab );
+#endif /* LOWMEM */
+}
+
 unsigned long
 getcolor(const char *colstr) {
 	Colormap cmap = DefaultColormap(dpy, screen);
+	Visual *vis = DefaultVisual(dpy, screen);
 	XColor color;
 
+	/* "#rrggbb" is parsed by Xlib and TrueColor pixels can be computed,
+	 * so the usual case needs no reply from the server */
+	if(vis->class == TrueColor && colstr[0] == '#' && XParseColor(dpy, cmap, colstr, &color))
+		return truecolor(color.red, vis->red_mask)
+		     | truecolor(color.green, vis->green_mask)
+		     | truecolor(color.blue, vis->blue_mask);
 	if(!XAllocNamedColor(dpy, cmap, colstr, &color, &color))
 		die("error, cannot allocate color '%s'\n", colstr);
 	return color.pixel;
@@ -939,6 +1854,13 @@ gettextprop(Window w, Atom atom, char *text, unsigned int size) {
 	XGetTextProperty(dpy, w, &name, atom);
 	if(!name.nitems)
 		return False;
+#ifdef XFT
+	/* Xft draws UTF-8 whatever the locale, STRING properties included */
+	if(Xutf8TextPropertyToTextList(dpy, &name, &list, &n) >= Success && n > 0 && *list) {
+		strncpy(text, *list, size - 1);
+		XFreeStringList(list);
+	}
+#else
 	if(name.encoding == XA_STRING)
 		strncpy(text, (char *)name.value, size - 1);
 	else {
@@ -947,6 +1869,7 @@ gettextprop(Window w, Atom atom, char *text, unsigned int size) {
 			XFreeStringList(list);
 		}
 	}
+#endif /* XFT */
 	text[size - 1] = '\0';
 	XFree(name.value);
 	return True;
@@ -954,51 +1877,69 @@ gettextprop(Window w, Atom atom, char *text, unsigned int size) {
 
 void
 grabbuttons(Client *c, Bool focused) {
-	updatenumlockmask();
-	{
-		unsigned int i, j;
-		unsigned int modifiers[] = { 0, LockMask, numlockmask, numlockmask|LockMask };
-		XUngrabButton(dpy, AnyButton, AnyModifier, c->win);
-		if(focused) {
-			for(i = 0; i < LENGTH(buttons); i++)
-				if(buttons[i].click == ClkClientWin)
-					for(j = 0; j < LENGTH(modifiers); j++)
-						XGrabButton(dpy, buttons[i].button,
-						            buttons[i].mask | modifiers[j],
-						            c->win, False, BUTTONMASK,
-						            GrabModeAsync, GrabModeSync, None, None);
-		}
-		else
-			XGrabButton(dpy, AnyButton, AnyModifier, c->win, False,
-			            BUTTONMASK, GrabModeAsync, GrabModeSync, None, None);
+	unsigned int i;
+	const int grab = focused ? GrabFocused : GrabUnfocused;
+
+	if(c->grab == grab) /* already in place */
+		return;
+	c->grab = grab;
+	XUngrabButton(dpy, AnyButton, AnyModifier, c->win);
+	if(focused) {
+		for(i = 0; i < nclientbuttons; i++)
+			XGrabButton(dpy, clientbuttons[i].button, clientbuttons[i].mask,
+			            c->win, False, BUTTONMASK,
+			            GrabModeAsync, GrabModeSync, None, None);
 	}
+	else
+		XGrabButton(dpy, AnyButton, AnyModifier, c->win, False,
+		            BUTTONMASK, GrabModeAsync, GrabModeSync, None, None);
 }
 
 void
 grabkeys(void) {
-	updatenumlockmask();
-	{
-		unsigned int i, j;
-		unsigned int modifiers[] = { 0, LockMask, numlockmask, numlockmask|LockMask };
-		KeyCode code;
-
-		XUngrabKey(dpy, AnyKey, AnyModifier, root);
-		for(i = 0; i < LENGTH(keys); i++) {
-			if((code = XKeysymToKeycode(dpy, keys[i].keysym)))
-				for(j = 0; j < LENGTH(modifiers); j++)
-					XGrabKey(dpy, code, keys[i].mod | modifiers[j], root,
-						 True, GrabModeAsync, GrabModeAsync);
+	unsigned int i, j, n;
+	unsigned int modifiers[] = { 0, LockMask, numlockmask, numlockmask|LockMask };
+	KeyCode code;
+
+	if(LENGTH(keys) >= KEYTABLESIZE)
+		die("fatal: more than %u key bindings\n", KEYTABLESIZE - 1);
+	memset(keytable, 0, sizeof(keytable));
+	XUngrabKey(dpy, AnyKey, AnyModifier, root);
+	for(i = 0; i < LENGTH(keys); i++) {
+		if((code = XKeysymToKeycode(dpy, keys[i].keysym))) {
+			for(j = 0; j < LENGTH(modifiers); j++)
+				XGrabKey(dpy, code, keys[i].mod | modifiers[j], root,
+					 True, GrabModeAsync, GrabModeAsync);
+			/* bindings sharing a slot keep their config order along the probe sequence */
+			for(n = KEYHASH(code, CLEANMASK(keys[i].mod)); keytable[n].key; n = (n + 1) & (KEYTABLESIZE - 1));
+			keytable[n].code = code;
+			keytable[n].mod = CLEANMASK(keys[i].mod);
+			keytable[n].key = &keys[i];
 		}
 	}
 }
 
-Bool
-hasurgentclient( const View *const v ) {
-	const Client *c;
-	for ( c = v->clients ; c ; c = c->next )
-		if ( c->isurgent )
-			return True;
-	return False;
+void
+handle( XEvent *e ) {
+#ifdef INSTRUMENT
+	struct timespec t;
+	const unsigned long rt = roundtrips;
+
+	clock_gettime( CLOCK_MONOTONIC, &t );
+#endif /* INSTRUMENT */
+#ifdef XRANDR
+	if ( rrevent != -1 && e->type == rrevent + RRScreenChangeNotify ) {
+		XRRUpdateConfiguration( e );
+		updatescreen( DisplayWidth( dpy, screen ), DisplayHeight( dpy, screen ) );
+	}
+	else
+#endif /* XRANDR */
+	if ( e->type < LASTEvent && handler[ e->type ] )
+		handler[ e->type ]( e ); /* call handler */
+#ifdef INSTRUMENT
+	if ( e->type < LASTEvent ) /* extension events are not accounted */
+		account( e->type, &t, rt );
+#endif /* INSTRUMENT */
 }
 
 void incmaster( const Arg *arg ) {
@@ -1009,10 +1950,68 @@ void incmaster( const Arg *arg ) {
 	arrange( selmon );
 }
 
+void
+hintsize( const SizeHints *s, int *w, int *h ) {
+	Bool baseismin;
+
+	/* see last two sentences in ICCCM 4.1.2.3 */
+	baseismin = s->basew == s->minw && s->baseh == s->minh;
+	if(!baseismin) { /* temporarily remove base dimensions */
+		*w -= s->basew;
+		*h -= s->baseh;
+	}
+	/* adjust for aspect limits */
+	if(s->mina > 0 && s->maxa > 0) {
+		if(s->maxa < (float)*w / *h)
+			*w = *h * s->maxa + 0.5;
+		else if(s->mina < (float)*h / *w)
+			*h = *w * s->mina + 0.5;
+	}
+	if(baseismin) { /* increment calculation requires this */
+		*w -= s->basew;
+		*h -= s->baseh;
+	}
+	/* adjust for increment value */
+	if(s->incw)
+		*w -= *w % s->incw;
+	if(s->inch)
+		*h -= *h % s->inch;
+	/* restore base dimensions */
+	*w += s->basew;
+	*h += s->baseh;
+	*w = MAX(*w, s->minw);
+	*h = MAX(*h, s->minh);
+	if(s->maxw)
+		*w = MIN(*w, s->maxw);
+	if(s->maxh)
+		*h = MIN(*h, s->maxh);
+}
+
+void
+ignoreenter( void ) {
+	/* crossing events caused by the requests sent so far carry at most
+	 * their serial, the no-op makes later ones carry a bigger one */
+	enterserial = NextRequest( dpy ) - 1;
+	XNoOp( dpy );
+}
+
 void
 initfont(const char *fontstr) {
-	char *def, **missing;
+#ifdef XFT
+	/* core font names keep working, fontconfig patterns are accepted too */
+	if(fontstr[0] == '-')
+		dc.font.xft = XftFontOpenXlfd(dpy, screen, fontstr);
+	else
+		dc.font.xft = XftFontOpenName(dpy, screen, fontstr);
+	if(!dc.font.xft && !(dc.font.xft = XftFontOpenName(dpy, screen, "monospace")))
+		die("error, cannot load font: '%s'\n", fontstr);
+	dc.font.ascent = dc.font.xft->ascent;
+	dc.font.descent = dc.font.xft->descent;
+	dc.font.height = dc.font.ascent + dc.font.descent;
+#else
 	int i, n;
+#ifndef LOWMEM
+	char *def, **missing;
 
 	missing = NULL;
 	dc.font.set = XCreateFontSet(dpy, fontstr, &missing, &n, &def);
@@ -1021,6 +2020,7 @@ initfont(const char *fontstr) {
 			fprintf(stderr, "dwm: missing fontset: %s\n", missing[n]);
 		XFreeStringList(missing);
 	}
+#endif /* LOWMEM */
 	if(dc.font.set) {
 		XFontSetExtents *font_extents;
 		XFontStruct **xfonts;
@@ -1041,8 +2041,292 @@ initfont(const char *fontstr) {
 			die("error, cannot load font: '%s'\n", fontstr);
 		dc.font.ascent = dc.font.xfont->ascent;
 		dc.font.descent = dc.font.xfont->descent;
+#ifdef LOWMEM
+		/* a single core font and no per character metrics, which are
+		 * megabytes for iso10646 fonts, widths come from max_bounds */
+		XFree(dc.font.xfont->per_char);
+		dc.font.xfont->per_char = NULL;
+#endif /* LOWMEM */
 	}
 	dc.font.height = dc.font.ascent + dc.font.descent;
+#endif /* XFT */
+}
+
+void
+invalidatebar( Monitor *m ) {
+	unsigned int i;
+
+	for ( i = 0 ; i < SegLast ; i++ )
+		m->segs[ i ].w = -1;
+}
+
+void
+ipcbroadcast( const char *msg, int len ) {
+	unsigned int i;
+
+	for ( i = 0 ; i < IPCCLIENTS ; i++ )
+		if ( ipcclients[ i ].fd != -1 && ipcclients[ i ].subscribed
+			&& send( ipcclients[ i ].fd, msg, len, MSG_NOSIGNAL ) != len )
+			ipcclose( &ipcclients[ i ] ); /* gone or not keeping up */
+}
+
+void
+ipccleanup( void ) {
+	unsigned int i;
+
+	if ( ipcfd == -1 )
+		return;
+	for ( i = 0 ; i < IPCCLIENTS ; i++ )
+		if ( ipcclients[ i ].fd != -1 )
+			ipcclose( &ipcclients[ i ] );
+	close( ipcfd );
+	ipcfd = -1;
+	unlink( ipcpath );
+}
+
+void
+ipcclose( IpcClient *ic ) {
+	close( ic->fd );
+	ic->fd = -1;
+}
+
+Bool
+ipcdispatch( struct pollfd *pfd, unsigned int n ) {
+	unsigned int i, j;
+	int fd;
+	Bool handled = False;
+
+	for ( i = 0 ; i < n ; i++ ) {
+		if ( !pfd[ i ].revents )
+			continue;
+		if ( pfd[ i ].fd == ipcfd ) {
+			while ( ( fd = accept( ipcfd, NULL, NULL ) ) != -1 ) {
+				for ( j = 0 ; j < IPCCLIENTS && ipcclients[ j ].fd != -1 ; j++ );
+				if ( j == IPCCLIENTS ) {
+					close( fd );
+					continue;
+				}
+				fcntl( fd, F_SETFD, FD_CLOEXEC );
+				fcntl( fd, F_SETFL, O_NONBLOCK );
+				ipcclients[ j ].fd = fd;
+				ipcclients[ j ].subscribed = ipcclients[ j ].dead = False;
+				ipcclients[ j ].len = 0;
+			}
+			continue;
+		}
+		for ( j = 0 ; j < IPCCLIENTS && ipcclients[ j ].fd != pfd[ i ].fd ; j++ );
+		if ( j < IPCCLIENTS && ipcread( &ipcclients[ j ] ) )
+			handled = True;
+	}
+	return handled;
+}
+
+void
+ipcnotify( void ) {
+	char buf[ 64 ];
+	unsigned int i;
+	int len;
+	Window w;
+	Monitor *m;
+
+	for ( i = 0 ; i < IPCCLIENTS && !( ipcclients[ i ].fd != -1 && ipcclients[ i ].subscribed ) ; i++ );
+	if ( i == IPCCLIENTS )
+		return;
+	for ( m = mons ; m ; m = m->next )
+		if ( m->ipcview != ( int ) m->selview ) {
+			m->ipcview = m->selview;
+			len = snprintf( buf, sizeof( buf ), "view %d %u\n", m->num, m->selview + 1 );
+			ipcbroadcast( buf, len );
+		}
+	w = SELVIEW( selmon ).sel ? SELVIEW( selmon ).sel->win : None;
+	if ( w != ipcfocus ) {
+		ipcfocus = w;
+		len = snprintf( buf, sizeof( buf ), "focus %d 0x%lx\n", selmon->num, w );
+		ipcbroadcast( buf, len );
+	}
+}
+
+const char *
+ipcparse( char *line, const IpcCommand **cmd, Arg *arg ) {
+	char *name, *val, *end;
+	unsigned int i;
+	long l;
+
+	name = strtok( line, " \t" );
+	val = strtok( NULL, " \t" );
+	if ( !name )
+		return "empty command";
+	if ( strtok( NULL, " \t" ) )
+		return "too many arguments";
+	for ( i = 0 ; i < LENGTH( ipccommands ) && strcmp( name, ipccommands[ i ].name ) ; i++ );
+	if ( i == LENGTH( ipccommands ) )
+		return "unknown command";
+	*cmd = &ipccommands[ i ];
+	if ( ( *cmd )->argtype == IpcArgNone )
+		return val ? "no argument expected" : NULL;
+	if ( !val )
+		return "argument expected";
+	switch ( ( *cmd )->argtype ) {
+	case IpcArgView: /* numbered like the tags, from 1 */
+		l = strtol( val, &end, 10 );
+		if ( *end || l < 1 || l > NUMVIEWS )
+			return "no such view";
+		arg->ui = l - 1;
+		break;
+	case IpcArgInt:
+		l = strtol( val, &end, 10 );
+		if ( *end )
+			return "integer expected";
+		arg->i = l;
+		break;
+	case IpcArgFloat:
+		arg->f = strtof( val, &end );
+		if ( *end )
+			return "number expected";
+		break;
+	case IpcArgLayout: /* by symbol */
+		for ( i = 0 ; i < LENGTH( layouts ) && strcmp( val, layouts[ i ].symbol ) ; i++ );
+		if ( i == LENGTH( layouts ) )
+			return "no such layout";
+		arg->v = &layouts[ i ];
+		break;
+	}
+	return NULL;
+}
+
+unsigned int
+ipcpollfds( struct pollfd *pfd ) {
+	unsigned int i, n = 0;
+
+	if ( ipcfd == -1 )
+		return 0;
+	pfd[ n ].fd = ipcfd;
+	pfd[ n++ ].events = POLLIN;
+	for ( i = 0 ; i < IPCCLIENTS ; i++ )
+		if ( ipcclients[ i ].fd != -1 ) {
+			pfd[ n ].fd = ipcclients[ i ].fd;
+			pfd[ n++ ].events = POLLIN;
+		}
+	return n;
+}
+
+Bool
+ipcread( IpcClient *ic ) {
+	char *p, *nl, *q, *qnl, *end, line[ IPCBUFSIZE ];
+	const char *err;
+	const IpcCommand *cmd;
+	Arg arg;
+	ssize_t n;
+	unsigned int pass;
+	Monitor *m;
+	Bool handled = False;
+
+	if ( ( n = read( ic->fd, ic->buf + ic->len, sizeof( ic->buf ) - ic->len ) ) <= 0 ) {
+		if ( n == 0 || ( errno != EAGAIN && errno != EINTR ) )
+			ipcclose( ic );
+		return False;
+	}
+	ic->len += n;
+	end = ic->buf + ic->len;
+	/* everything done for one read is arranged once, by flushdirty() */
+	holdarrange = True;
+	for ( p = ic->buf ; !ic->dead && ( nl = memchr( p, '\n', end - p ) ) ; p = nl + 1 ) {
+		*nl = '\0';
+		if ( !strcmp( p, "subscribe" ) ) {
+			ic->subscribed = True;
+			ipcfocus = ~( Window ) 0; /* make ipcnotify() send the current state */
+			for ( m = mons ; m ; m = m->next )
+				m->ipcview = -1;
+			ipcreply( ic, "ok\n" );
+			handled = True;
+			continue;
+		}
+		if ( strcmp( p, "begin" ) ) {
+			if ( !( err = ipcparse( p, &cmd, &arg ) ) ) {
+				cmd->func( &arg );
+				handled = True;
+			}
+		}
+		else {
+			/* a transaction only runs once it is buffered up to "commit" */
+			for ( q = nl + 1 ; ( qnl = memchr( q, '\n', end - q ) ) && ( qnl - q != 6 || memcmp( q, "commit", 6 ) ) ; q = qnl + 1 );
+			if ( !qnl ) {
+				*nl = '\n';
+				break;
+			}
+			/* the first pass only parses, one bad line rejects all of them */
+			for ( pass = 0, err = NULL ; pass < 2 && !err ; pass++ )
+				for ( q = nl + 1 ; !err && q < qnl - 6 ; q += strlen( q ) + 1 ) {
+					if ( !pass )
+						*( char * ) memchr( q, '\n', qnl - q ) = '\0';
+					strcpy( line, q );
+					if ( !( err = ipcparse( line, &cmd, &arg ) ) && pass ) {
+						cmd->func( &arg );
+						handled = True;
+					}
+				}
+			nl = qnl;
+		}
+		if ( err ) {
+			snprintf( line, sizeof( line ), "error %s\n", err );
+			ipcreply( ic, line );
+		}
+		else
+			ipcreply( ic, "ok\n" );
+	}
+	holdarrange = False;
+	ic->len = end - p;
+	memmove( ic->buf, p, ic->len );
+	if ( ic->len == sizeof( ic->buf ) ) {
+		ipcreply( ic, "error line or transaction too long\n" );
+		ic->dead = True;
+	}
+	if ( ic->dead )
+		ipcclose( ic );
+	return handled;
+}
+
+void
+ipcreply( IpcClient *ic, const char *msg ) {
+	const int len = strlen( msg );
+
+	if ( !ic->dead && send( ic->fd, msg, len, MSG_NOSIGNAL ) != len )
+		ic->dead = True;
+}
+
+void
+ipcsetup( void ) {
+	struct sockaddr_un addr;
+	unsigned int i;
+	mode_t mask;
+
+	for ( i = 0 ; i < IPCCLIENTS ; i++ )
+		ipcclients[ i ].fd = -1;
+	if ( !ipcsocket[ 0 ] )
+		return;
+	memset( &addr, 0, sizeof( addr ) );
+	addr.sun_family = AF_UNIX;
+	if ( snprintf( addr.sun_path, sizeof( addr.sun_path ), ipcsocket, DisplayString( dpy ) ) >= ( int ) sizeof( addr.sun_path ) ) {
+		fprintf( stderr, "dwm: control socket path too long\n" );
+		return;
+	}
+	if ( ( ipcfd = socket( AF_UNIX, SOCK_STREAM, 0 ) ) == -1 ) {
+		fprintf( stderr, "dwm: cannot create control socket: %s\n", strerror( errno ) );
+		return;
+	}
+	unlink( addr.sun_path ); /* left behind by a dwm that did not exit cleanly */
+	mask = umask( 077 );
+	if ( bind( ipcfd, ( struct sockaddr * ) &addr, sizeof( addr ) ) == -1 || listen( ipcfd, IPCCLIENTS ) == -1 ) {
+		fprintf( stderr, "dwm: cannot listen on %s: %s\n", addr.sun_path, strerror( errno ) );
+		close( ipcfd );
+		ipcfd = -1;
+	}
+	umask( mask );
+	if ( ipcfd == -1 )
+		return;
+	fcntl( ipcfd, F_SETFD, FD_CLOEXEC );
+	fcntl( ipcfd, F_SETFL, O_NONBLOCK );
+	strcpy( ipcpath, addr.sun_path );
 }
 
 Bool
@@ -1075,17 +2359,15 @@ isuniquegeom(XineramaScreenInfo *unique, size_t len, XineramaScreenInfo *info) {
 
 void
 keypress(XEvent *e) {
-	unsigned int i;
-	KeySym keysym;
+	unsigned int i, mod;
+	const Key *k;
 	XKeyEvent *ev;
 
 	ev = &e->xkey;
-	keysym = XKeycodeToKeysym(dpy, (KeyCode)ev->keycode, 0);
-	for(i = 0; i < LENGTH(keys); i++)
-		if(keysym == keys[i].keysym
-		&& CLEANMASK(keys[i].mod) == CLEANMASK(ev->state)
-		&& keys[i].func)
-			keys[i].func(&(keys[i].arg));
+	mod = CLEANMASK(ev->state);
+	for(i = KEYHASH(ev->keycode, mod); (k = keytable[i].key); i = (i + 1) & (KEYTABLESIZE - 1))
+		if(keytable[i].code == ev->keycode && keytable[i].mod == mod && k->func)
+			k->func(&(k->arg));
 }
 
 void
@@ -1115,44 +2397,56 @@ killclient( const Arg *arg ) {
 }
 
 void
-manage( Window w, XWindowAttributes *wa ) {
-	static Client cz;
+manage( Window w, XWindowAttributes *wa, const ClientState *cs ) {
 	Client *c, *t = NULL;
 	Window trans = None;
 	XWindowChanges wc;
 
-	if ( !( c = malloc( sizeof( Client ) ) ) )
-		die( "fatal: could not malloc() %u bytes\n", sizeof( Client ) );
-	*c = cz;
+	c = allocclient();
 	c->win = w;
-	updatetitle( c );
-	if ( XGetTransientForHint( dpy, w, &trans ) )
-		t = wintoclient( trans );
-	c->mon = t ? t->mon : selmon;
-	c->view = c->mon->selview;
-	applyrules( c );
-	/* geometry */
-	c->x = c->oldx = wa->x + c->mon->wx;
-	c->y = c->oldy = wa->y + c->mon->wy;
-	c->w = c->oldw = wa->width;
-	c->h = c->oldh = wa->height;
-	c->oldbw = wa->border_width;
-	if ( c->w == c->mon->mw && c->h == c->mon->mh ) {
-		c->isfloating = 1;
-		c->x = c->mon->mx;
-		c->y = c->mon->my;
-		c->bw = 0;
+	c->titlestale = True;
+	if ( cs ) { /* handed over by restart(), no rules and no placement */
+		for ( c->mon = mons ; c->mon && c->mon->num != cs->mon ; c->mon = c->mon->next );
+		if ( !c->mon )
+			c->mon = selmon;
+		c->view = cs->view < NUMVIEWS ? cs->view : c->mon->selview;
+		c->isfloating = cs->isfloating;
+		c->x = c->oldx = cs->x;
+		c->y = c->oldy = cs->y;
+		c->w = c->oldw = cs->w;
+		c->h = c->oldh = cs->h;
+		c->bw = cs->bw;
+		c->oldbw = cs->oldbw;
 	}
 	else {
-		if ( c->x + WIDTH( c ) > c->mon->mx + c->mon->mw )
-			c->x = c->mon->mx + c->mon->mw - WIDTH( c );
-		if ( c->y + HEIGHT( c ) > c->mon->my + c->mon->mh )
-			c->y = c->mon->my + c->mon->mh - HEIGHT( c );
-		c->x = MAX( c->x, c->mon->mx );
-		/* only fix client y-offset, if the client center might cover the bar */
-		c->y = MAX( c->y, ( ( c->mon->by == 0 ) && ( c->x + ( c->w / 2 ) >= c->mon->wx )
-			&& ( c->x + ( c->w / 2 ) < c->mon->wx + c->mon->ww ) ) ? bh : c->mon->my );
-		c->bw = borderpx;
+		if ( XGetTransientForHint( dpy, w, &trans ) )
+			t = wintoclient( trans );
+		c->mon = t ? t->mon : selmon;
+		c->view = c->mon->selview;
+		applyrules( c );
+		/* geometry */
+		c->x = c->oldx = wa->x + c->mon->wx;
+		c->y = c->oldy = wa->y + c->mon->wy;
+		c->w = c->oldw = wa->width;
+		c->h = c->oldh = wa->height;
+		c->oldbw = wa->border_width;
+		if ( c->w == c->mon->mw && c->h == c->mon->mh ) {
+			c->isfloating = 1;
+			c->x = c->mon->mx;
+			c->y = c->mon->my;
+			c->bw = 0;
+		}
+		else {
+			if ( c->x + WIDTH( c ) > c->mon->mx + c->mon->mw )
+				c->x = c->mon->mx + c->mon->mw - WIDTH( c );
+			if ( c->y + HEIGHT( c ) > c->mon->my + c->mon->mh )
+				c->y = c->mon->my + c->mon->mh - HEIGHT( c );
+			c->x = MAX( c->x, c->mon->mx );
+			/* only fix client y-offset, if the client center might cover the bar */
+			c->y = MAX( c->y, ( ( c->mon->by == 0 ) && ( c->x + ( c->w / 2 ) >= c->mon->wx )
+				&& ( c->x + ( c->w / 2 ) < c->mon->wx + c->mon->ww ) ) ? bh : c->mon->my );
+			c->bw = borderpx;
+		}
 	}
 	wc.border_width = c->bw;
 	XConfigureWindow( dpy, w, CWBorderWidth, &wc );
@@ -1167,7 +2461,14 @@ manage( Window w, XWindowAttributes *wa ) {
 		XRaiseWindow( dpy, c->win );
 	attach( c );
 	attachstack( c );
+	attachwin( c );
+	c->ishidden = True; /* until arrange() shows it */
 	XMoveResizeWindow( dpy, c->win, c->x + 2 * sw, c->y, c->w, c->h ); /* some windows require this */
+	c->sentx = c->x + 2 * sw;
+	c->senty = c->y;
+	c->sentw = c->w;
+	c->senth = c->h;
+	c->sentbw = c->bw;
 	XMapWindow( dpy, c->win );
 	setclientstate( c, NormalState );
 	arrange( c->mon );
@@ -1175,11 +2476,52 @@ manage( Window w, XWindowAttributes *wa ) {
 
 void
 mappingnotify(XEvent *e) {
+	unsigned int i;
+	Client *c;
+	Monitor *m;
 	XMappingEvent *ev = &e->xmapping;
 
 	XRefreshKeyboardMapping(ev);
-	if(ev->request == MappingKeyboard)
-		grabkeys();
+	if(ev->request != MappingKeyboard && ev->request != MappingModifier)
+		return;
+	/* the only place the lock modifiers can change */
+	updatenumlockmask();
+	updatebuttongrabs();
+	grabkeys();
+	for(m = mons; m; m = m->next)
+		for(i = 0; i < NUMVIEWS; i++)
+			for(c = m->views[i].clients; c; c = c->next) {
+				c->grab = GrabNone;
+				grabbuttons(c, c == SELVIEW(selmon).sel);
+			}
+}
+
+void
+matchrules( const char *class, RuleResult *rr ) {
+	static Bool matched[ LENGTH( rules ) ];
+	const char *p;
+	unsigned int i;
+	int k;
+
+	/* a rule matches if its class is a substring, only rules starting with
+	 * the byte at hand are tried at each position */
+	for ( i = 0 ; i < LENGTH( rules ) ; i++ )
+		matched[ i ] = !rulelen[ i ];
+	for ( p = class ; *p ; p++ )
+		for ( k = rulehead[ ( unsigned char ) *p ] ; k >= 0 ; k = rulenext[ k ] )
+			if ( !matched[ k ] && !strncmp( p, rules[ k ].class, rulelen[ k ] ) )
+				matched[ k ] = True;
+	/* later rules override earlier ones */
+	rr->view = rr->isfloating = -1;
+	for ( i = 0 ; i < LENGTH( rules ) ; i++ )
+		if ( matched[ i ] ) {
+			rr->isfloating = rules[ i ].isfloating;
+			if ( 0 != rules[ i ].view )
+				rr->view = rules[ i ].view - 1;
+		}
+	strncpy( rr->class, class, sizeof( rr->class ) - 1 );
+	rr->class[ sizeof( rr->class ) - 1 ] = '\0';
+	rr->used = True;
 }
 
 void
@@ -1192,101 +2534,30 @@ maprequest(XEvent *e) {
 	if(wa.override_redirect)
 		return;
 	if(!wintoclient(ev->window))
-		manage(ev->window, &wa);
+		manage(ev->window, &wa, NULL);
 }
 
 void
-mirrortile( Monitor *const m ) {
-	int x, y, h, w, rw, mh;
-	unsigned int nclient, nstack, nprocessed;
-	const unsigned int nmaster = SELVIEW( m ).nmaster;
-	Client *c;
-
-	// test amount of client window
-
-	for ( nclient = 0, c = nexttiled( SELVIEW( m ).clients ) ; c ; c = nexttiled( c->next ), nclient++ );
-	if ( 0 == nclient )
-		return;
-
-	// prepare common variables for later usage
-
-	c = nexttiled( SELVIEW( m ).clients );
-
-	if ( 0 < nmaster ) {
-		if ( nmaster < nclient ) {
-			mh = m->wh * SELVIEW( m ).mfact;
-		} else {
-			mh = m->wh;
-		}
-	} else {
-		mh = 0;
-	}
-
-	// mirror-tile clients in master area
-
-	nprocessed = 0;
-	if ( nmaster ) {
-		x = m->wx;
-		y = m->wy;
-		w = ( nmaster <= nclient ) ? ( m->ww / nmaster ) : ( m->ww / nclient );
-		rw =( nmaster <= nclient ) ? ( m->ww % nmaster ) : ( m->ww % nclient );
-		h = mh;
-
-		while ( NULL != c && nprocessed < nmaster ) {
-			resize( c, x, y,
-				w - 2 * c->bw + ( ( nprocessed < rw ) ? 1 : 0 ),
-				h - 2 * c->bw,
-				False
-			);
-
-			x = c->x + WIDTH( c );
-			c = nexttiled( c->next );
-			++nprocessed;
-		}
-	}
-
-	// mirror-tile clients in stacked area
-
-	nstack = nclient - nprocessed;
-	nprocessed = 0;
-	if ( 0 < nstack ) {
-		x = m->wx;
-		y = m->wy + mh;
-		w = m->ww / nstack;
-		rw = m->ww % nstack;
-		h = m->wh - mh;
-
-		while ( NULL != c ) {
-			resize( c, x, y,
-				w - 2 * c->bw + ( ( nprocessed < rw ) ? 1 : 0 ),
-				h - 2 * c->bw,
-				False
-			);
-
-			x = c->x + WIDTH( c );
-			c = nexttiled( c->next );
-			++nprocessed;
-		}
-	}
+mirrortile( const Tiling *t, Rect *r ) {
+	tilearea( t, r, True );
 }
 
 void
-monocle( Monitor *const m ) {
-	unsigned int n = 0;
-	Client *c;
+monocle( const Tiling *t, Rect *r ) {
+	unsigned int i;
 
-	for ( c = SELVIEW( m ).clients ; c ; c = c->next )
-		n++;
-	if ( n > 0 ) /* override layout symbol */
-		snprintf( m->ltsymbol, sizeof( m->ltsymbol ), "[%d]", n );
-	for ( c = nexttiled( SELVIEW( m ).clients ) ; c ; c = nexttiled( c->next ) )
-		resize( c, m->wx, m->wy, m->ww - 2 * c->bw, m->wh - 2 * c->bw, False );
+	if ( t->nall > 0 ) /* override layout symbol */
+		snprintf( t->symbol, t->symbolsize, "[%d]", t->nall );
+	for ( i = 0 ; i < t->n ; i++ )
+		r[ i ] = t->area;
 }
 
 void
 movemouse( const Arg *arg ) {
-	// TODO: Refactor me.
 	int x, y, ocx, ocy, nx, ny;
+	Bool pending = False;
+	Time last = 0;
+	unsigned long long due = 0;
 	Client *const c = SELVIEW( selmon ).sel;
 	Monitor *m;
 	XEvent ev;
@@ -1295,25 +2566,34 @@ movemouse( const Arg *arg ) {
 		return;
 
 	restack( selmon );
-	ocx = c->x;
-	ocy = c->y;
+	ocx = nx = c->x;
+	ocy = ny = c->y;
 
-	if ( !( XGrabPointer( dpy, root, False, MOUSEMASK, GrabModeAsync, GrabModeAsync,
-		None, cursor[ CurMove ], CurrentTime ) == GrabSuccess ) )
+	if ( !draggrab( cursor[ CurMove ] ) )
 		return;
-	if ( !getrootptr( &x, &y ) )
+	if ( !dragorigin( &x, &y ) )
 		return;
+	dragbegin( c );
 	do {
-		XMaskEvent( dpy, MOUSEMASK | ExposureMask | SubstructureRedirectMask, &ev );
+		dragevent( &ev, pending, due );
 
 		switch ( ev.type ) {
 		case ConfigureRequest:
 		case Expose:
 		case MapRequest:
 			handler[ ev.type ]( &ev );
+			flushdirty();
+			break;
+
+		case DRAGFRAME: /* the pointer rests, catch up with it */
+			if ( !( !c->isfloating && SELVIEW( selmon ).lt->arrange ) )
+				dragstep( c, nx, ny, c->w, c->h );
+			pending = False;
+			last += 1000 / dragfps;
 			break;
 
 		case MotionNotify:
+			pending = !dragframe( &ev, &last, &due );
 			nx = ocx + ( ev.xmotion.x - x );
 			ny = ocy + ( ev.xmotion.y - y );
 			if ( snap
@@ -1330,14 +2610,19 @@ movemouse( const Arg *arg ) {
 					ny = selmon->wy + selmon->wh - HEIGHT( c );
 
 				if ( ( !c->isfloating && SELVIEW( selmon ).lt->arrange )
-					&& ( snap < abs( nx - c->x ) || snap < abs( ny - c->y ) ) )
+					&& ( snap < abs( nx - c->x ) || snap < abs( ny - c->y ) ) ) {
+					drawoutline();
 					togglefloating( NULL );
+					drawoutline();
+				}
 			}
-			if ( !( !c->isfloating && SELVIEW( selmon ).lt->arrange ) )
-				resize( c, nx, ny, c->w, c->h, True );
+			if ( !pending && !( !c->isfloating && SELVIEW( selmon ).lt->arrange ) )
+				dragstep( c, nx, ny, c->w, c->h );
 			break;
 		}
 	} while ( ev.type != ButtonRelease );
+	dragend( c, ( pending || dragoutline ) && !( !c->isfloating && SELVIEW( selmon ).lt->arrange ),
+		nx, ny, c->w, c->h );
 	XUngrabPointer( dpy, CurrentTime );
 
 	if ( ( m = ptrtomon( c->x + c->w / 2, c->y + c->h / 2 ) ) != selmon ) {
@@ -1347,44 +2632,40 @@ movemouse( const Arg *arg ) {
 	}
 }
 
+unsigned long long
+monotonic( void ) {
+	struct timespec t;
+
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return t.tv_sec * 1000ULL + t.tv_nsec / 1000000;
+}
+
 void
 movestack( const Arg *arg ) {
-	unsigned int n;
-	Client *c, *cn, *pc, *ppc;
+	Client *c, *cn, *pc;
 
-	for ( c = SELVIEW( selmon ).clients, n = 0 ; c ; c = c->next )
-		n++;
-	if ( !( 1 < n ) )
+	if ( !( 1 < SELVIEW( selmon ).ntiled + SELVIEW( selmon ).nfloating ) )
 		return;
 
+	c = SELVIEW( selmon ).sel;
 	if ( 0 < arg->i ) {
-		c = SELVIEW( selmon ).sel;
+		/* swap with the next client, the last one wraps to the head */
 		cn = c->next;
 		detach( c );
-		if ( cn ) {
-			c->next = cn->next;
-			cn->next = c;
-		} else {
-			c->next = SELVIEW( selmon ).clients;
-			SELVIEW( selmon ).clients = c;
-		}
-		SELVIEW( selmon ).sel = c;
+		attachafter( c, cn );
 	} else {
-		c = SELVIEW( selmon ).sel;
-		pc = prevclient( c, SELVIEW( selmon ).clients );
-		ppc = prevclient( pc, SELVIEW( selmon ).clients );
+		pc = c->prev;
 		if ( c == SELVIEW( selmon ).clients ) {
-			SELVIEW( selmon ).clients = c->next;
-			c->next = NULL;
-			pc->next = c;
-		} else if ( c == SELVIEW( selmon ).clients->next ) {
-			SELVIEW( selmon ).clients = c;
-			ppc->next = pc;
-			pc->next = NULL;
+			/* the head goes to the end */
+			detach( c );
+			attachafter( c, pc );
+		} else if ( pc == SELVIEW( selmon ).clients ) {
+			/* the second one becomes the head, the old head goes to the end */
+			detach( pc );
+			attachafter( pc, SELVIEW( selmon ).clients->prev );
 		} else {
-			ppc->next = c;
-			pc->next = c->next;
-			c->next = pc;
+			detach( c );
+			attachafter( c, pc->prev );
 		}
 	}
 
@@ -1402,16 +2683,145 @@ void
 movetoview(const Arg *arg) {
 	Client *const c = SELVIEW( selmon ).sel;
 
-	if ( c ) {
+	if ( c && c->view != arg->ui ) {
 		detach( c );
 		detachstack( c );
 		c->view = arg->ui;
 		attach( c );
 		attachstack( c );
+		c->ishidden = True;
+		XMoveWindow( dpy, c->win, c->sentx = c->x + 2 * sw, c->senty = c->y );
 		arrange( selmon );
 	}
 }
 
+#ifdef INSTRUMENT
+unsigned long
+fontbytes( const XFontStruct *f ) {
+	unsigned long n = sizeof( XFontStruct ) + f->n_properties * sizeof( XFontProp );
+
+	/* client side copy only, the glyphs live in the server */
+	if ( f->per_char )
+		n += ( f->max_byte1 - f->min_byte1 + 1 ) * ( f->max_char_or_byte2 - f->min_char_or_byte2 + 1 )
+			* sizeof( XCharStruct );
+	return n;
+}
+#endif /* INSTRUMENT */
+
+#ifdef INSTRUMENT
+unsigned long
+percentile( const Stats *st, unsigned int pct ) {
+	unsigned int i;
+	unsigned long n = 0;
+
+	/* upper bound of the bucket holding the pct-th percentile, in us */
+	for ( i = 0 ; i < NUMBUCKETS - 1 ; i++ )
+		if ( ( n += st->buckets[ i ] ) * 100 >= st->count * pct )
+			break;
+	return 2UL << i;
+}
+
+void
+phase( const char *name ) {
+	static struct timespec start, last;
+	static unsigned long lastrt = 0;
+	struct timespec now;
+
+	/* startup phases, from the first call on */
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	if ( !name )
+		start = now;
+	else
+		fprintf( stderr, "dwm: startup %-12s %8.3f ms %8.3f ms total %4lu roundtrips\n", name,
+			( now.tv_sec - last.tv_sec ) * 1000.0 + ( now.tv_nsec - last.tv_nsec ) / 1000000.0,
+			( now.tv_sec - start.tv_sec ) * 1000.0 + ( now.tv_nsec - start.tv_nsec ) / 1000000.0,
+			roundtrips - lastrt );
+	last = now;
+	lastrt = roundtrips;
+}
+
+void
+printmem( void ) {
+	unsigned long nclients = 0, nslabs = 0, nfree = 0, ntitles = 0, titlebytes = 0;
+	unsigned long fonts = 0, nfonts = 0, pixmap = 0, nmons = 0;
+	int i, n;
+	char **names;
+	XFontStruct **xfonts;
+	XPixmapFormatValues *pf;
+	ClientSlab *slab;
+	Monitor *m;
+	Client *c;
+#ifdef LOWMEM
+	Title *t;
+
+	for ( i = 0 ; i < TITLEHASHSIZE ; i++ )
+		for ( t = titles[ i ] ; t ; t = t->next ) {
+			ntitles++;
+			titlebytes += sizeof( Title ) + strlen( t->name ) + 1;
+		}
+#endif /* LOWMEM */
+
+	/* bytes held by dwm itself, not by the server on its behalf */
+	for ( slab = slabs ; slab ; slab = slab->next )
+		nslabs++;
+	for ( c = freeclients ; c ; c = c->next )
+		nfree++;
+	for ( m = mons ; m ; m = m->next, nmons++ )
+		for ( i = 0 ; i < NUMVIEWS ; i++ )
+			for ( c = m->views[ i ].clients ; c ; c = c->next ) {
+				nclients++;
+#ifndef LOWMEM
+				ntitles++;
+				titlebytes += c->namesize;
+#endif /* LOWMEM */
+			}
+	if ( dc.font.set )
+		for ( i = 0, n = XFontsOfFontSet( dc.font.set, &xfonts, &names ) ; i < n ; i++, nfonts++ )
+			fonts += fontbytes( xfonts[ i ] );
+	else if ( dc.font.xfont ) {
+		fonts = fontbytes( dc.font.xfont );
+		nfonts = 1;
+	}
+	/* the bar pixmap is allocated by the server, shown for completeness */
+	if ( ( pf = XListPixmapFormats( dpy, &n ) ) ) {
+		for ( i = 0 ; i < n ; i++ )
+			if ( pf[ i ].depth == DefaultDepth( dpy, screen ) )
+				pixmap = ( unsigned long ) drawablew * bh * pf[ i ].bits_per_pixel / 8;
+		XFree( pf );
+	}
+	fprintf( stderr, "dwm: mem clients   %8lu bytes, %lu in use, %lu free in %lu slabs\n",
+		nslabs * sizeof( ClientSlab ), nclients, nfree, nslabs );
+	fprintf( stderr, "dwm: mem titles    %8lu bytes, %lu buffers\n", titlebytes, ntitles );
+	fprintf( stderr, "dwm: mem fonts     %8lu bytes, %lu font structs\n", fonts, nfonts );
+	fprintf( stderr, "dwm: mem monitors  %8lu bytes, %lu monitors\n", nmons * sizeof( Monitor ), nmons );
+	fprintf( stderr, "dwm: mem tables    %8lu bytes, static caches and indexes\n",
+		( unsigned long ) ( sizeof( wintable ) + sizeof( keytable ) + sizeof( rulecache )
+		+ sizeof( textcache ) + sizeof( ipcclients ) + sizeof( stats ) ) );
+	fprintf( stderr, "dwm: mem pixmap    %8lu bytes, %dx%d bar pixmap in the server\n", pixmap, drawablew, bh );
+}
+
+void
+printstats( void ) {
+	unsigned int i;
+	char buf[ 32 ];
+	const Stats *st;
+
+	fprintf( stderr, "dwm: %-17s %8s %10s %8s %8s %8s %8s %10s\n", "event", "count",
+		"total(us)", "max(us)", "p50(us)", "p90(us)", "p99(us)", "roundtrips" );
+	for ( i = 0 ; i <= LASTEvent ; i++ ) {
+		st = &stats[ i ];
+		if ( !st->count )
+			continue;
+		if ( !evnames[ i ] )
+			snprintf( buf, sizeof( buf ), "event %u", i );
+		fprintf( stderr, "dwm: %-17s %8lu %10llu %8llu %8lu %8lu %8lu %10lu\n",
+			evnames[ i ] ? evnames[ i ] : buf, st->count, st->total / 1000, st->max / 1000,
+			percentile( st, 50 ), percentile( st, 90 ), percentile( st, 99 ), st->roundtrips );
+	}
+	memset( stats, 0, sizeof( stats ) ); /* every dump covers the time since the last one */
+}
+#endif /* INSTRUMENT */
+
 Client *
 nexttiled( Client *c ) {
 	for ( ; c && c->isfloating ; c = c->next );
@@ -1428,51 +2838,45 @@ ptrtomon(int x, int y) {
 	return selmon;
 }
 
-Client *
-prevclient( Client *c, Client *head ) {
-	Client *pc;
-
-	if ( c ) {
-		for ( pc = head ; pc && pc->next != c ; pc = pc->next );
-		if ( !pc )
-			for ( pc = head ; pc && pc->next ; pc = pc->next );
-	} else
-		pc = NULL;
-
-	return pc;
-}
-
 void
 propertynotify( XEvent *e ) {
 	Client *c;
 	Window trans;
 	XPropertyEvent *ev = &e->xproperty;
 
-	if ( ( ev->window == root ) && ( ev->atom == XA_WM_NAME ) )
-		updatestatus();
+	if ( ( ev->window == root ) && ( ev->atom == XA_WM_NAME ) ) {
+		/* read at most statusrate times per second, the last change always wins */
+		if ( !statusrate || monotonic() >= laststatus + 1000 / statusrate )
+			updatestatus();
+		else if ( !timers[ TimerStatus ].due )
+			timers[ TimerStatus ].due = laststatus + 1000 / statusrate;
+	}
 	else if ( ev->state == PropertyDelete )
 		return; /* ignore */
 	else if ( ( c = wintoclient( ev->window ) ) ) {
 		switch ( ev->atom ) {
 		case XA_WM_TRANSIENT_FOR:
 			XGetTransientForHint( dpy, c->win, &trans );
-			if ( !c->isfloating && ( c->isfloating = ( wintoclient( trans ) != NULL ) ) )
-				arrange( c->mon );
+			if ( !c->isfloating && wintoclient( trans ) ) {
+				setfloating( c, True );
+				c->mon->dirty |= DirtyLayout;
+			}
 			break;
 		case XA_WM_NORMAL_HINTS:
 			updatesizehints( c );
 			break;
-		case XA_WM_HINTS:
+		case XA_WM_HINTS: /* urgency is only shown on the bar of its monitor */
 			updatewmhints( c );
-			drawbars();
+			c->mon->dirty |= DirtyBar;
 			break;
 		default:
 			break;
 		}
 		if ( ev->atom == XA_WM_NAME || ev->atom == netatom[ NetWMName ] ) {
-			updatetitle( c );
-			if ( c == c->mon->views[ c->view ].sel )
-				drawbar( c->mon );
+			/* only the selected client of a visible view is drawn, fetch it then */
+			c->titlestale = True;
+			if ( ISVISIBLE( c ) && c == c->mon->views[ c->view ].sel )
+				c->mon->dirty |= DirtyBar;
 		}
 	}
 }
@@ -1491,14 +2895,15 @@ clientmessage(XEvent *e) {
 			c->oldstate = c->isfloating;
 			c->oldbw = c->bw;
 			c->bw = 0;
-			c->isfloating = 1;
+			setfloating(c, True);
 			resizeclient(c, c->mon->mx, c->mon->my, c->mon->mw, c->mon->mh);
 			XRaiseWindow(dpy, c->win);
+			c->stackbelow = None;
 		}
 		else {
 			XChangeProperty(dpy, cme->window, netatom[NetWMState], XA_ATOM, 32,
 			                PropModeReplace, (unsigned char*)0, 0);
-			c->isfloating = c->oldstate;
+			setfloating(c, c->oldstate);
 			c->bw = c->oldbw;
 			c->x = c->oldx;
 			c->y = c->oldy;
@@ -1515,6 +2920,421 @@ quit(const Arg *arg) {
 	running = False;
 }
 
+void
+releasename( Client *c ) {
+#ifdef LOWMEM
+	Title *t, **tp;
+
+	if ( !c->name )
+		return;
+	t = ( Title * ) ( c->name - offsetof( Title, name ) );
+	if ( !--t->refs ) {
+		for ( tp = &titles[ titlebucket( t->name ) ] ; *tp != t ; tp = &( *tp )->next );
+		*tp = t->next;
+		free( t );
+	}
+#else
+	free( c->name );
+#endif /* LOWMEM */
+	c->name = NULL;
+	c->namesize = 0;
+}
+
+#ifdef INSTRUMENT
+void
+record( const XEvent *e ) {
+	const unsigned short type = e ? e->type : 0;
+	unsigned short len;
+	unsigned int i;
+	Monitor *m;
+
+	/* only store the member of the union the event type uses */
+	switch ( type ) {
+	case 0:                len = 0; break;
+	case KeyPress:
+	case KeyRelease:       len = sizeof( XKeyEvent ); break;
+	case ButtonPress:
+	case ButtonRelease:    len = sizeof( XButtonEvent ); break;
+	case MotionNotify:     len = sizeof( XMotionEvent ); break;
+	case EnterNotify:
+	case LeaveNotify:      len = sizeof( XCrossingEvent ); break;
+	case FocusIn:
+	case FocusOut:         len = sizeof( XFocusChangeEvent ); break;
+	case Expose:           len = sizeof( XExposeEvent ); break;
+	case DestroyNotify:    len = sizeof( XDestroyWindowEvent ); break;
+	case UnmapNotify:      len = sizeof( XUnmapEvent ); break;
+	case MapRequest:       len = sizeof( XMapRequestEvent ); break;
+	case ConfigureNotify:  len = sizeof( XConfigureEvent ); break;
+	case ConfigureRequest: len = sizeof( XConfigureRequestEvent ); break;
+	case PropertyNotify:   len = sizeof( XPropertyEvent ); break;
+	case ClientMessage:    len = sizeof( XClientMessageEvent ); break;
+	case MappingNotify:    len = sizeof( XMappingEvent ); break;
+	default:               len = sizeof( XEvent ); break;
+	}
+	/* describe the windows an event is the first to name, replay()
+	 * creates stand-ins for them */
+	for ( i = 0, m = mons ; m ; m = m->next, i++ )
+		if ( !standin( m->barwin ) )
+			recordwindow( m->barwin, TraceBar, i );
+	if ( type == MapRequest && !standin( e->xmaprequest.window ) )
+		recordwindow( e->xmaprequest.window, TraceClient, 0 );
+	else if ( type == ConfigureRequest && !standin( e->xconfigurerequest.window ) )
+		recordwindow( e->xconfigurerequest.window, TraceClient, 0 );
+	else if ( type == DestroyNotify && standin( e->xdestroywindow.window ) )
+		dropstandin( standin( e->xdestroywindow.window ) ); /* the id may be reused */
+	tracewrite( type, e, len );
+	if ( !e ) /* keep everything up to the last batch if dwm dies */
+		fflush( trace );
+}
+
+void
+recordstart( void ) {
+	Atom atoms[ WMLast + NetLast ];
+
+	memcpy( atoms, wmatom, sizeof( wmatom ) );
+	memcpy( atoms + WMLast, netatom, sizeof( netatom ) );
+	tracewrite( TRACEATOMS, atoms, sizeof( atoms ) );
+	recordwindow( root, TraceRoot, 0 );
+}
+
+void
+recordwindow( Window w, unsigned int kind, unsigned int mon ) {
+	static TraceWindow tz;
+	TraceWindow tw = tz;
+	XWindowAttributes wa;
+	XClassHint ch = { NULL, NULL };
+	long msize;
+
+	tw.win = w;
+	tw.kind = kind;
+	tw.mon = mon;
+	if ( kind == TraceClient || kind == TraceScanned ) {
+		if ( !XGetWindowAttributes( dpy, w, &wa ) )
+			tw.kind = TraceGone; /* destroyed already, replayed as None */
+		else {
+			tw.x = wa.x;
+			tw.y = wa.y;
+			tw.w = wa.width;
+			tw.h = wa.height;
+			tw.bw = wa.border_width;
+			tw.override = wa.override_redirect;
+			if ( !XGetTransientForHint( dpy, w, &tw.transient ) )
+				tw.transient = None;
+			if ( !XGetWMNormalHints( dpy, w, &tw.hints, &msize ) )
+				tw.hints.flags = 0;
+			if ( XGetClassHint( dpy, w, &ch ) ) {
+				strncpy( tw.class, ch.res_class ? ch.res_class : "", sizeof( tw.class ) - 1 );
+				strncpy( tw.instance, ch.res_name ? ch.res_name : "", sizeof( tw.instance ) - 1 );
+				if ( ch.res_class )
+					XFree( ch.res_class );
+				if ( ch.res_name )
+					XFree( ch.res_name );
+			}
+			gettextprop( w, XA_WM_NAME, tw.name, sizeof( tw.name ) );
+		}
+	}
+	addstandin( w, w, False );
+	tracewrite( TRACEWINDOW, &tw, sizeof( tw ) );
+}
+
+void
+replay( const char *path ) {
+	char magic[ sizeof( TRACEMAGIC ) - 1 ];
+	int type;
+	XEvent ev;
+
+	if ( !( replaytrace = fopen( path, "rb" ) ) )
+		die( "dwm: cannot open trace %s: %s\n", path, strerror( errno ) );
+	if ( fread( magic, sizeof( magic ), 1, replaytrace ) != 1 || memcmp( magic, TRACEMAGIC, sizeof( magic ) ) )
+		die( "dwm: %s is not a dwm trace\n", path );
+	XSync( dpy, False );
+	/* dispatch exactly what run() dispatched, as fast as possible, drags
+	 * read their events through dragevent() */
+	while ( running && ( type = replayevent( &ev ) ) >= 0 ) {
+		if ( !type )
+			flushdirty();
+		else
+			handle( &ev );
+	}
+	flushdirty();
+	fclose( replaytrace );
+	replaytrace = NULL;
+	printstats();
+}
+
+Atom
+replayatom( Atom a ) {
+	unsigned int i;
+
+	if ( a <= XA_LAST_PREDEFINED ) /* the same on every server */
+		return a;
+	for ( i = 0 ; i < WMLast ; i++ )
+		if ( tracedatoms[ i ] == a )
+			return wmatom[ i ];
+	for ( i = 0 ; i < NetLast ; i++ )
+		if ( tracedatoms[ WMLast + i ] == a )
+			return netatom[ i ];
+	return None; /* not one dwm compares with */
+}
+
+int
+replayevent( XEvent *ev ) {
+	TraceRecord r;
+	TraceWindow tw;
+
+	/* the next event, 0 for the end of a batch and -1 for the end, the
+	 * records describing the traced session are applied on the way */
+	while ( fread( &r, sizeof( r ), 1, replaytrace ) == 1 ) {
+		if ( r.type == TRACEATOMS ) {
+			if ( r.len != sizeof( tracedatoms ) || fread( tracedatoms, r.len, 1, replaytrace ) != 1 )
+				die( "dwm: truncated trace\n" );
+			continue;
+		}
+		if ( r.type == TRACEWINDOW ) {
+			if ( r.len != sizeof( tw ) || fread( &tw, r.len, 1, replaytrace ) != 1 )
+				die( "dwm: truncated trace\n" );
+			replaywindow( &tw );
+			continue;
+		}
+		memset( ev, 0, sizeof( *ev ) );
+		if ( r.len > sizeof( *ev ) || ( r.len && fread( ev, r.len, 1, replaytrace ) != 1 ) )
+			die( "dwm: truncated trace\n" );
+		ev->xany.display = dpy;
+		if ( r.type )
+			replayremap( ev );
+		return r.type;
+	}
+	return -1;
+}
+
+void
+replayremap( XEvent *ev ) {
+	StandIn *s;
+
+	/* the windows and atoms of the traced session by their stand-ins */
+	switch ( ev->type ) {
+	case KeyPress:
+	case KeyRelease:
+		ev->xkey.window = replaywin( ev->xkey.window, False );
+		ev->xkey.root = replaywin( ev->xkey.root, False );
+		ev->xkey.subwindow = replaywin( ev->xkey.subwindow, False );
+		break;
+	case ButtonPress:
+	case ButtonRelease:
+		ev->xbutton.window = replaywin( ev->xbutton.window, False );
+		ev->xbutton.root = replaywin( ev->xbutton.root, False );
+		ev->xbutton.subwindow = replaywin( ev->xbutton.subwindow, False );
+		break;
+	case MotionNotify:
+		ev->xmotion.window = replaywin( ev->xmotion.window, False );
+		ev->xmotion.root = replaywin( ev->xmotion.root, False );
+		ev->xmotion.subwindow = replaywin( ev->xmotion.subwindow, False );
+		break;
+	case EnterNotify:
+	case LeaveNotify:
+		ev->xcrossing.window = replaywin( ev->xcrossing.window, False );
+		ev->xcrossing.root = replaywin( ev->xcrossing.root, False );
+		ev->xcrossing.subwindow = replaywin( ev->xcrossing.subwindow, False );
+		break;
+	case DestroyNotify:
+		/* the client is gone from here on, so is its stand-in */
+		if ( ( s = standin( ev->xdestroywindow.window ) ) && s->created ) {
+			XDestroyWindow( dpy, s->win );
+			ev->xdestroywindow.window = s->win;
+			dropstandin( s );
+		}
+		else
+			ev->xdestroywindow.window = replaywin( ev->xdestroywindow.window, False );
+		ev->xdestroywindow.event = replaywin( ev->xdestroywindow.event, False );
+		break;
+	case UnmapNotify:
+		if ( ( s = standin( ev->xunmap.window ) ) && s->created )
+			XUnmapWindow( dpy, s->win );
+		ev->xunmap.window = replaywin( ev->xunmap.window, False );
+		ev->xunmap.event = replaywin( ev->xunmap.event, False );
+		break;
+	case MapRequest:
+		ev->xmaprequest.window = replaywin( ev->xmaprequest.window, True );
+		ev->xmaprequest.parent = replaywin( ev->xmaprequest.parent, False );
+		break;
+	case ConfigureNotify:
+		ev->xconfigure.window = replaywin( ev->xconfigure.window, False );
+		ev->xconfigure.event = replaywin( ev->xconfigure.event, False );
+		ev->xconfigure.above = replaywin( ev->xconfigure.above, False );
+		break;
+	case ConfigureRequest:
+		ev->xconfigurerequest.window = replaywin( ev->xconfigurerequest.window, True );
+		ev->xconfigurerequest.parent = replaywin( ev->xconfigurerequest.parent, False );
+		ev->xconfigurerequest.above = replaywin( ev->xconfigurerequest.above, False );
+		break;
+	case PropertyNotify:
+		ev->xproperty.window = replaywin( ev->xproperty.window, False );
+		ev->xproperty.atom = replayatom( ev->xproperty.atom );
+		break;
+	case ClientMessage:
+		ev->xclient.window = replaywin( ev->xclient.window, False );
+		ev->xclient.message_type = replayatom( ev->xclient.message_type );
+		if ( ev->xclient.message_type == netatom[ NetWMState ] ) {
+			ev->xclient.data.l[ 1 ] = replayatom( ev->xclient.data.l[ 1 ] );
+			ev->xclient.data.l[ 2 ] = replayatom( ev->xclient.data.l[ 2 ] );
+		}
+		break;
+	default:
+		ev->xany.window = replaywin( ev->xany.window, False );
+		break;
+	}
+}
+
+Window
+replaywin( Window w, Bool need ) {
+	StandIn *s;
+
+	if ( ( s = standin( w ) ) )
+		return s->win;
+	if ( need ) /* dwm acts on it, replaying without it would measure nothing */
+		die( "dwm: window 0x%lx of the trace was not recorded\n", w );
+	return None; /* dwm only looks it up and finds no client either way */
+}
+
+void
+replaywindow( const TraceWindow *tw ) {
+	XSetWindowAttributes swa;
+	XWindowAttributes wa;
+	XClassHint ch;
+	Window w, trans;
+	unsigned int i;
+	Monitor *m;
+
+	if ( standin( tw->win ) ) /* read again, dragorigin() went back */
+		return;
+	switch ( tw->kind ) {
+	case TraceRoot:
+		addstandin( tw->win, root, False );
+		return;
+	case TraceBar:
+		for ( i = 0, m = mons ; m && i < tw->mon ; m = m->next, i++ );
+		addstandin( tw->win, m ? m->barwin : None, False );
+		return;
+	case TraceGone:
+		addstandin( tw->win, None, False );
+		return;
+	}
+	/* a window of the same size and properties in place of the client */
+	swa.override_redirect = tw->override;
+	w = XCreateWindow( dpy, root, tw->x, tw->y, MAX( 1, tw->w ), MAX( 1, tw->h ), tw->bw,
+	                   CopyFromParent, InputOutput, CopyFromParent, CWOverrideRedirect, &swa );
+	ch.res_class = ( char * ) tw->class;
+	ch.res_name = ( char * ) tw->instance;
+	XSetClassHint( dpy, w, &ch );
+	XStoreName( dpy, w, tw->name );
+	if ( tw->hints.flags )
+		XSetWMNormalHints( dpy, w, ( XSizeHints * ) &tw->hints );
+	if ( tw->transient && ( trans = replaywin( tw->transient, False ) ) )
+		XSetTransientForHint( dpy, w, trans );
+	addstandin( tw->win, w, True );
+	/* managed by scan() when the trace began, there is no MapRequest */
+	if ( tw->kind == TraceScanned && XGetWindowAttributes( dpy, w, &wa ) )
+		manage( w, &wa, NULL );
+}
+#endif /* INSTRUMENT */
+
+void
+restart( const Arg *arg ) {
+	restarting = True;
+	running = False;
+}
+
+void
+restorestate( Window *wins, XWindowAttributes *wa, unsigned int num ) {
+	Atom type;
+	int format;
+	unsigned long i, j, n, extra;
+	unsigned char *p = NULL;
+	const StateHeader *h;
+	const MonitorState *ms;
+	const ClientState *cs, **sorted, **found;
+	ClientState key;
+	const ClientState *const pkey = &key;
+	const long *stack;
+	Monitor *m;
+	Client *c;
+
+	/* the property is deleted on read, a later restart from a crash won't see it */
+	if ( XGetWindowProperty( dpy, root, wmatom[ WMRestart ], 0L, 0x1fffffffL, True, XA_CARDINAL,
+		&type, &format, &n, &extra, &p ) != Success || !p )
+		return;
+	h = ( const StateHeader * ) p;
+	if ( format != 32 || n < sizeof( *h ) / sizeof( long ) || h->version != 1 || h->nmons < 0 || h->nclients < 0
+		|| n != ( sizeof( *h ) + h->nmons * sizeof( *ms ) + h->nclients * ( sizeof( *cs ) + sizeof( long ) ) ) / sizeof( long ) ) {
+		XFree( p );
+		return;
+	}
+	ms = ( const MonitorState * ) ( h + 1 );
+	cs = ( const ClientState * ) ( ms + h->nmons );
+	stack = ( const long * ) ( cs + h->nclients );
+
+	for ( i = 0 ; i < h->nmons ; i++, ms++ ) {
+		for ( m = mons ; m && m->num != ms->num ; m = m->next );
+		if ( !m )
+			continue;
+		if ( ms->selview >= 0 && ms->selview < NUMVIEWS )
+			m->selview = ms->selview;
+		if ( m->showbar != ms->showbar ) {
+			m->showbar = ms->showbar;
+			updatebarpos( m );
+			XMoveResizeWindow( dpy, m->barwin, m->wx, m->by, m->ww, bh );
+		}
+		for ( j = 0 ; j < NUMVIEWS ; j++ ) {
+			m->views[ j ].nmaster = ms->views[ j ][ 0 ];
+			m->views[ j ].mfact = ms->views[ j ][ 1 ] / 10000.0;
+			if ( ms->views[ j ][ 2 ] >= 0 && ms->views[ j ][ 2 ] < LENGTH( layouts ) )
+				m->views[ j ].lt = &layouts[ ms->views[ j ][ 2 ] ];
+		}
+	}
+
+	/* manage the windows which are still around */
+	if ( h->nclients ) {
+		if ( !( sorted = malloc( h->nclients * sizeof( *sorted ) ) ) )
+			die( "fatal: could not malloc() %u bytes\n", h->nclients * sizeof( *sorted ) );
+		for ( i = 0 ; i < h->nclients ; i++ )
+			sorted[ i ] = &cs[ i ];
+		qsort( sorted, h->nclients, sizeof( *sorted ), cmpstate );
+		for ( i = 0 ; i < num ; i++ ) {
+			if ( !wins[ i ] )
+				continue;
+			key.win = wins[ i ];
+			if ( ( found = bsearch( &pkey, sorted, h->nclients, sizeof( *sorted ), cmpstate ) ) ) {
+#ifdef INSTRUMENT
+				if ( trace ) /* replayed without the saved state */
+					recordwindow( wins[ i ], TraceScanned, 0 );
+#endif /* INSTRUMENT */
+				manage( wins[ i ], &wa[ i ], *found );
+				wins[ i ] = None;
+			}
+		}
+		free( sorted );
+	}
+
+	/* manage() attached in query tree order, restore the saved orders */
+	for ( i = h->nclients ; i-- > 0 ; )
+		if ( ( c = wintoclient( cs[ i ].win ) ) ) {
+			detach( c );
+			attach( c );
+		}
+	for ( i = h->nclients ; i-- > 0 ; )
+		if ( ( c = wintoclient( stack[ i ] ) ) ) {
+			detachstack( c );
+			attachstack( c );
+		}
+	for ( m = mons ; m ; m = m->next ) {
+		for ( j = 0 ; j < NUMVIEWS ; j++ )
+			m->views[ j ].sel = m->views[ j ].stack;
+		m->shownview = -1;
+	}
+	XFree( p );
+	arrange( NULL );
+}
+
 void
 resize(Client *c, int x, int y, int w, int h, Bool interact) {
 	if(applysizehints(c, &x, &y, &w, &h, interact))
@@ -1523,21 +3343,25 @@ resize(Client *c, int x, int y, int w, int h, Bool interact) {
 
 void
 resizeclient(Client *c, int x, int y, int w, int h) {
-	XWindowChanges wc;
-
-	c->oldx = c->x; c->x = wc.x = x;
-	c->oldy = c->y; c->y = wc.y = y;
-	c->oldw = c->w; c->w = wc.width = w;
-	c->oldh = c->h; c->h = wc.height = h;
-	wc.border_width = c->bw;
-	XConfigureWindow(dpy, c->win, CWX|CWY|CWWidth|CWHeight|CWBorderWidth, &wc);
-	configure(c);
-	XSync(dpy, False);
+	c->oldx = c->x; c->x = x;
+	c->oldy = c->y; c->y = y;
+	c->oldw = c->w; c->w = w;
+	c->oldh = c->h; c->h = h;
+	if ( !batchgeom )
+		configureclient( c );
+	else if ( !c->ispending ) { /* queued until flushgeom() */
+		c->ispending = True;
+		c->pnext = c->mon->pending;
+		c->mon->pending = c;
+	}
 }
 
 void
 resizemouse( const Arg *arg ) {
 	int ocx, ocy, nw, nh;
+	Bool pending = False;
+	Time last = 0;
+	unsigned long long due = 0;
 	Client *const c = SELVIEW( selmon ).sel;
 	Monitor *m;
 	XEvent ev;
@@ -1548,40 +3372,55 @@ resizemouse( const Arg *arg ) {
 	restack( selmon );
 	ocx = c->x;
 	ocy = c->y;
+	nw = c->w;
+	nh = c->h;
 
-	if ( !( XGrabPointer( dpy, root, False, MOUSEMASK, GrabModeAsync, GrabModeAsync,
-		None, cursor[ CurResize ], CurrentTime ) == GrabSuccess ) )
+	if ( !draggrab( cursor[ CurResize ] ) )
 		return;
 	XWarpPointer( dpy, None, c->win, 0, 0, 0, 0, c->w + c->bw - 1, c->h + c->bw - 1 );
+	dragbegin( c );
 	do {
-		XMaskEvent( dpy, MOUSEMASK | ExposureMask | SubstructureRedirectMask, &ev );
+		dragevent( &ev, pending, due );
 
 		switch ( ev.type ) {
 		case ConfigureRequest:
 		case Expose:
 		case MapRequest:
 			handler[ ev.type ]( &ev );
+			flushdirty();
+			break;
+
+		case DRAGFRAME:
+			if ( !( !c->isfloating && SELVIEW( selmon ).lt->arrange ) )
+				dragstep( c, c->x, c->y, nw, nh );
+			pending = False;
+			last += 1000 / dragfps;
 			break;
 
 		case MotionNotify:
+			pending = !dragframe( &ev, &last, &due );
 			nw = MAX( ev.xmotion.x - ocx - 2 * c->bw + 1, 1 );
 			nh = MAX( ev.xmotion.y - ocy - 2 * c->bw + 1, 1 );
 			if ( snap
 				&& ( selmon->wx <= nw && nw <= selmon->wx + selmon->ww )
 				&& ( selmon->wy <= nh && nh <= selmon->wy + selmon->wh ) ) {
 				if ( ( !c->isfloating && SELVIEW( selmon ).lt->arrange )
-					&& ( abs( nw - c->w ) > snap || abs( nh - c->h ) > snap ) )
+					&& ( abs( nw - c->w ) > snap || abs( nh - c->h ) > snap ) ) {
+					drawoutline();
 					togglefloating( NULL );
+					drawoutline();
+				}
 			}
-			if ( !( !c->isfloating && SELVIEW( selmon ).lt->arrange ) )
-				resize( c, c->x, c->y, nw, nh, True );
+			if ( !pending && !( !c->isfloating && SELVIEW( selmon ).lt->arrange ) )
+				dragstep( c, c->x, c->y, nw, nh );
 			break;
 		}
 	} while ( ev.type != ButtonRelease );
+	dragend( c, ( pending || dragoutline ) && !( !c->isfloating && SELVIEW( selmon ).lt->arrange ),
+		c->x, c->y, nw, nh );
 	XWarpPointer( dpy, None, c->win, 0, 0, 0, 0, c->w + c->bw - 1, c->h + c->bw - 1 );
 	XUngrabPointer( dpy, CurrentTime );
-
-	while ( XCheckMaskEvent( dpy, EnterWindowMask, &ev ) );
+	ignoreenter(); /* the warp must not focus another client */
 	if ( ( m = ptrtomon( c->x + c->w / 2, c->y + c->h / 2 ) ) != selmon ) {
 		sendmon( c, m );
 		selmon = m;
@@ -1592,59 +3431,215 @@ resizemouse( const Arg *arg ) {
 void
 restack( Monitor *const m ) {
 	Client *c;
-	XEvent ev;
 	XWindowChanges wc;
 
-	drawbar( m );
+	m->dirty |= DirtyBar;
 	if ( !SELVIEW( m ).sel )
 		return;
-	if ( SELVIEW( m ).sel->isfloating || !SELVIEW( m ).lt->arrange )
+	if ( SELVIEW( m ).sel->isfloating || !SELVIEW( m ).lt->arrange ) {
 		XRaiseWindow( dpy, SELVIEW( m ).sel->win );
+		SELVIEW( m ).sel->stackbelow = None;
+	}
 	if ( SELVIEW( m ).lt->arrange ) {
+		/* tiled clients go below the bar in focus order. Only raising a
+		 * window breaks the order below it, so a client which still sits
+		 * below the sibling it was last put under stays where it is. */
 		wc.stack_mode = Below;
 		wc.sibling = m->barwin;
 		for ( c = SELVIEW( m ).stack ; c ; c = c->snext )
 			if ( !c->isfloating ) {
-				XConfigureWindow( dpy, c->win, CWSibling | CWStackMode, &wc );
+				if ( c->stackbelow != wc.sibling ) {
+					XConfigureWindow( dpy, c->win, CWSibling | CWStackMode, &wc );
+					c->stackbelow = wc.sibling;
+				}
 				wc.sibling = c->win;
 			}
 	}
-	XSync( dpy, False );
-	while ( XCheckMaskEvent( dpy, EnterWindowMask, &ev ) );
+	if ( batchgeom ) /* arrange() filters crossing events for all monitors */
+		return;
+	ignoreenter();
 }
 
 void
 run(void) {
 	XEvent ev;
+	struct pollfd pfd[1 + 1 + IPCCLIENTS]; /* X, control socket and its connections */
+	unsigned int n;
+	Bool handled = False;
+	int timeout;
+
+	pfd[0].fd = ConnectionNumber(dpy);
+	pfd[0].events = POLLIN;
 	/* main event loop */
 	XSync(dpy, False);
-	while(running && !XNextEvent(dpy, &ev)) {
-		if(handler[ev.type])
-			handler[ev.type](&ev); /* call handler */
+	flushdirty();
+	PHASE("first frame");
+	while(running) {
+		/* drain everything already queued before doing deferred work */
+		for(; running && XPending(dpy); handled = True) {
+			XNextEvent(dpy, &ev);
+			if(ev.type == EnterNotify && (long)(ev.xcrossing.serial - enterserial) <= 0)
+				continue; /* caused by our own moving and restacking */
+			coalesce(&ev);
+#ifdef INSTRUMENT
+			if(trace)
+				record(&ev);
+#endif /* INSTRUMENT */
+			handle(&ev);
+		}
+		if(runtimers(&timeout) || handled) {
+			flushdirty();
+#ifdef INSTRUMENT
+			if(trace)
+				record(NULL);
+#endif /* INSTRUMENT */
+			handled = False;
+			continue; /* flushing may have produced new events */
+		}
+#ifdef INSTRUMENT
+		if(dumpstats) {
+			dumpstats = 0;
+			printstats();
+			printmem();
+		}
+#endif /* INSTRUMENT */
+		/* XPending() flushed the output buffer, sleep until the server or a timer wakes us */
+		if(!running)
+			break;
+		n = 1 + ipcpollfds(pfd + 1);
+		if(poll(pfd, n, timeout) == -1) {
+			if(errno != EINTR)
+				die("dwm: poll failed: %s\n", strerror(errno));
+		}
+		else /* control commands are flushed like X events */
+			handled = ipcdispatch(pfd + 1, n - 1);
+	}
+}
+
+Bool
+runtimers( int *timeout ) {
+	unsigned int i;
+	unsigned long long now = monotonic(), next = 0;
+	Bool fired = False;
+
+	for ( i = 0 ; i < TimerLast ; i++ )
+		if ( timers[ i ].due && timers[ i ].due <= now ) {
+			timers[ i ].due = 0;
+			timers[ i ].func();
+			fired = True;
+		}
+	/* the callbacks may have rearmed themselves */
+	for ( i = 0 ; i < TimerLast ; i++ )
+		if ( timers[ i ].due && ( !next || timers[ i ].due < next ) )
+			next = timers[ i ].due;
+	*timeout = next ? ( next > now ? ( int )( next - now ) : 0 ) : -1;
+	return fired;
+}
+
+Bool
+latermotion( Display *d, XEvent *e, XPointer arg ) {
+	Bool *const released = ( Bool * ) arg;
+
+	if ( e->type == ButtonRelease )
+		*released = True;
+	return !*released && e->type == MotionNotify;
+}
+
+Bool
+samepropev( Display *d, XEvent *e, XPointer arg ) {
+	const XPropertyEvent *const ev = &( ( XEvent * ) arg )->xproperty;
+
+	return e->type == PropertyNotify && e->xproperty.window == ev->window
+		&& e->xproperty.atom == ev->atom && e->xproperty.state == ev->state;
+}
+
+void
+savestate( void ) {
+	unsigned long n = 0, nmons = 0, nclients = 0;
+	unsigned int i;
+	long *data, *stack;
+	StateHeader *h;
+	MonitorState *ms;
+	ClientState *cs;
+	Monitor *m;
+	Client *c;
+
+	for ( m = mons ; m ; m = m->next, nmons++ )
+		for ( i = 0 ; i < NUMVIEWS ; i++ )
+			nclients += m->views[ i ].ntiled + m->views[ i ].nfloating;
+	n = ( sizeof( *h ) + nmons * sizeof( *ms ) + nclients * ( sizeof( *cs ) + sizeof( long ) ) ) / sizeof( long );
+	if ( !( data = calloc( n, sizeof( long ) ) ) )
+		die( "fatal: could not calloc() %u bytes\n", n * sizeof( long ) );
+	h = ( StateHeader * ) data;
+	h->version = 1;
+	h->nmons = nmons;
+	h->nclients = nclients;
+	ms = ( MonitorState * ) ( h + 1 );
+	cs = ( ClientState * ) ( ms + nmons );
+	stack = ( long * ) ( cs + nclients );
+	for ( m = mons ; m ; m = m->next, ms++ ) {
+		ms->num = m->num;
+		ms->selview = m->selview;
+		ms->showbar = m->showbar;
+		for ( i = 0 ; i < NUMVIEWS ; i++ ) {
+			ms->views[ i ][ 0 ] = m->views[ i ].nmaster;
+			ms->views[ i ][ 1 ] = m->views[ i ].mfact * 10000 + 0.5;
+			ms->views[ i ][ 2 ] = m->views[ i ].lt - layouts;
+			for ( c = m->views[ i ].clients ; c ; c = c->next, cs++ ) {
+				cs->win = c->win;
+				cs->mon = m->num;
+				cs->view = i;
+				cs->isfloating = c->isfloating;
+				cs->x = c->x;
+				cs->y = c->y;
+				cs->w = c->w;
+				cs->h = c->h;
+				cs->bw = c->bw;
+				cs->oldbw = c->oldbw;
+			}
+			for ( c = m->views[ i ].stack ; c ; c = c->snext )
+				*stack++ = c->win;
+		}
 	}
+	XChangeProperty( dpy, root, wmatom[ WMRestart ], XA_CARDINAL, 32, PropModeReplace,
+		( unsigned char * ) data, n );
+	free( data );
 }
 
 void
 scan(void) {
 	unsigned int i, num;
 	Window d1, d2, *wins = NULL;
-	XWindowAttributes wa;
+	XWindowAttributes *wa = NULL;
 
 	if(XQueryTree(dpy, root, &d1, &d2, &wins, &num)) {
-		for(i = 0; i < num; i++) {
-			if(!XGetWindowAttributes(dpy, wins[i], &wa)
-			|| wa.override_redirect || XGetTransientForHint(dpy, wins[i], &d1))
-				continue;
-			if(wa.map_state == IsViewable || getstate(wins[i]) == IconicState)
-				manage(wins[i], &wa);
-		}
-		for(i = 0; i < num; i++) { /* now the transients */
-			if(!XGetWindowAttributes(dpy, wins[i], &wa))
-				continue;
-			if(XGetTransientForHint(dpy, wins[i], &d1)
-			&& (wa.map_state == IsViewable || getstate(wins[i]) == IconicState))
-				manage(wins[i], &wa);
-		}
+		if(num && !(wa = malloc(num * sizeof(XWindowAttributes))))
+			die("fatal: could not malloc() %u bytes\n", num * sizeof(XWindowAttributes));
+		/* every window is queried once, unmanageable ones are dropped from
+		 * the list and WM_STATE is only read for unmapped windows */
+		for(i = 0; i < num; i++)
+			if(!XGetWindowAttributes(dpy, wins[i], &wa[i]) || wa[i].override_redirect
+			|| (wa[i].map_state != IsViewable && getstate(wins[i]) != IconicState))
+				wins[i] = None;
+		restorestate(wins, wa, num);
+		for(i = 0; i < num; i++)
+			if(wins[i] && !XGetTransientForHint(dpy, wins[i], &d1)) {
+#ifdef INSTRUMENT
+				if(trace)
+					recordwindow(wins[i], TraceScanned, 0);
+#endif /* INSTRUMENT */
+				manage(wins[i], &wa[i], NULL);
+				wins[i] = None;
+			}
+		for(i = 0; i < num; i++) /* now the transients */
+			if(wins[i]) {
+#ifdef INSTRUMENT
+				if(trace)
+					recordwindow(wins[i], TraceScanned, 0);
+#endif /* INSTRUMENT */
+				manage(wins[i], &wa[i], NULL);
+			}
+		free(wa);
 		if(wins)
 			XFree(wins);
 	}
@@ -1656,12 +3651,13 @@ sendmon( Client *c, Monitor *m ) {
 		unfocus( c, True );
 		detach( c );
 		detachstack( c );
+		c->mon->dirty |= DirtyLayout;
 		c->mon = m;
 		c->view = m->selview;
 		attach( c );
 		attachstack( c );
 		focus( NULL );
-		arrange( NULL );
+		m->dirty |= DirtyLayout; /* only the two monitors involved */
 	}
 }
 
@@ -1673,6 +3669,13 @@ setclientstate(Client *c, long state) {
 			PropModeReplace, (unsigned char *)data, 2);
 }
 
+void
+setfloating( Client *c, Bool isfloating ) {
+	tally( c, -1 );
+	c->isfloating = isfloating ? True : False;
+	tally( c, +1 );
+}
+
 void
 setlayout( const Arg *arg ) {
 	SELVIEW( selmon ).lt = ( Layout * ) arg->v;
@@ -1680,7 +3683,7 @@ setlayout( const Arg *arg ) {
 	if ( SELVIEW( selmon ).sel )
 		arrange( selmon );
 	else
-		drawbar( selmon );
+		selmon->dirty |= DirtyBar;
 }
 
 void
@@ -1696,33 +3699,110 @@ setmfact( const Arg *arg ) {
 	}
 }
 
+void
+seturgent( Client *c, Bool isurgent ) {
+	tally( c, -1 );
+	c->isurgent = isurgent;
+	tally( c, +1 );
+}
+
+void
+setname( Client *c, const char *name ) {
+	const unsigned int len = strlen( name );
+#ifdef LOWMEM
+	const unsigned int h = titlebucket( name );
+	Title *t;
+
+	/* titles are interned, clients with the same title share it */
+	if ( c->name && !strcmp( c->name, name ) )
+		return;
+	for ( t = titles[ h ] ; t && strcmp( t->name, name ) ; t = t->next );
+	if ( !t ) {
+		if ( !( t = malloc( sizeof( Title ) + len + 1 ) ) )
+			die( "fatal: could not malloc() %u bytes\n", sizeof( Title ) + len + 1 );
+		memcpy( t->name, name, len + 1 );
+		t->refs = 0;
+		t->next = titles[ h ];
+		titles[ h ] = t;
+	}
+	t->refs++;
+	releasename( c );
+	c->name = t->name;
+	c->namesize = len + 1;
+#else
+	if ( len >= c->namesize ) {
+		c->namesize = len + 1 < 64 ? 64 : len + 1;
+		if ( !( c->name = realloc( c->name, c->namesize ) ) )
+			die( "fatal: could not realloc() %u bytes\n", c->namesize );
+	}
+	memcpy( c->name, name, len + 1 );
+#endif /* LOWMEM */
+	c->namelen = len;
+}
+
 void
 setup(void) {
+	static char *atomnames[ WMLast + NetLast ] = {
+		[WMProtocols] = "WM_PROTOCOLS",
+		[WMDelete] = "WM_DELETE_WINDOW",
+		[WMState] = "WM_STATE",
+		[WMRestart] = "_DWM_RESTART_STATE",
+		[WMLast + NetSupported] = "_NET_SUPPORTED",
+		[WMLast + NetWMName] = "_NET_WM_NAME",
+		[WMLast + NetWMState] = "_NET_WM_STATE",
+		[WMLast + NetWMFullscreen] = "_NET_WM_STATE_FULLSCREEN",
+	};
+	Atom atoms[ WMLast + NetLast ];
+	unsigned int i;
+#ifdef XRANDR
+	int n;
+#endif /* XRANDR */
 	XSetWindowAttributes wa;
-
+	struct sigaction sa;
+
+	/* handlers stay installed, SA_RESTART keeps Xlib's reads and writes
+	 * going, poll() in run() still returns early */
+	memset(&sa, 0, sizeof(sa));
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+	sa.sa_handler = sigchld;
+	if(sigaction(SIGCHLD, &sa, NULL) == -1)
+		die("Can't install SIGCHLD handler");
+#ifdef INSTRUMENT
+	sa.sa_flags = SA_RESTART;
+	sa.sa_handler = sigusr1;
+	if(sigaction(SIGUSR1, &sa, NULL) == -1)
+		die("Can't install SIGUSR1 handler");
+#endif /* INSTRUMENT */
 	/* clean up any zombies immediately */
 	sigchld(0);
+	/* children must not inherit the X connection */
+	fcntl(ConnectionNumber(dpy), F_SETFD, FD_CLOEXEC);
 
 	/* init screen */
 	screen = DefaultScreen(dpy);
 	root = RootWindow(dpy, screen);
 	initfont(font);
+	PHASE("font");
 	sw = DisplayWidth(dpy, screen);
 	sh = DisplayHeight(dpy, screen);
 	bh = dc.h = dc.font.height + 2;
+	for(i = 0; i < NUMVIEWS; i++)
+		tagw[i] = TEXTW(tags[i]);
+	compilerules();
 	updategeom();
-	/* init atoms */
-	wmatom[WMProtocols] = XInternAtom(dpy, "WM_PROTOCOLS", False);
-	wmatom[WMDelete] = XInternAtom(dpy, "WM_DELETE_WINDOW", False);
-	wmatom[WMState] = XInternAtom(dpy, "WM_STATE", False);
-	netatom[NetSupported] = XInternAtom(dpy, "_NET_SUPPORTED", False);
-	netatom[NetWMName] = XInternAtom(dpy, "_NET_WM_NAME", False);
-	netatom[NetWMState] = XInternAtom(dpy, "_NET_WM_STATE", False);
-	netatom[NetWMFullscreen] = XInternAtom(dpy, "_NET_WM_STATE_FULLSCREEN", False);
-	/* init cursors */
+	PHASE("geometry");
+	/* init atoms, one round trip for all of them */
+	if(!XInternAtoms(dpy, atomnames, LENGTH(atomnames), False, atoms))
+		die("error, cannot intern atoms\n");
+	memcpy(wmatom, atoms, sizeof(wmatom));
+	memcpy(netatom, atoms + WMLast, sizeof(netatom));
+	PHASE("atoms");
+	/* init cursors, these requests have no reply */
 	cursor[CurNormal] = XCreateFontCursor(dpy, XC_left_ptr);
 	cursor[CurResize] = XCreateFontCursor(dpy, XC_sizing);
 	cursor[CurMove] = XCreateFontCursor(dpy, XC_fleur);
+	PHASE("cursors");
 	/* init appearance */
 	dc.norm[ColBorder] = getcolor(normbordercolor);
 	dc.norm[ColBG] = getcolor(normbgcolor);
@@ -1730,14 +3810,24 @@ setup(void) {
 	dc.sel[ColBorder] = getcolor(selbordercolor);
 	dc.sel[ColBG] = getcolor(selbgcolor);
 	dc.sel[ColFG] = getcolor(selfgcolor);
-	dc.drawable = XCreatePixmap(dpy, root, DisplayWidth(dpy, screen), bh, DefaultDepth(dpy, screen));
+#ifdef XFT
+	xftcolor(normbordercolor, &dc.xftnorm[ColBorder]);
+	xftcolor(normbgcolor, &dc.xftnorm[ColBG]);
+	xftcolor(normfgcolor, &dc.xftnorm[ColFG]);
+	xftcolor(selbordercolor, &dc.xftsel[ColBorder]);
+	xftcolor(selbgcolor, &dc.xftsel[ColBG]);
+	xftcolor(selfgcolor, &dc.xftsel[ColFG]);
+#endif /* XFT */
+	PHASE("colors");
+	updatedrawable();
 	dc.gc = XCreateGC(dpy, root, 0, NULL);
 	XSetLineAttributes(dpy, dc.gc, 1, LineSolid, CapButt, JoinMiter);
-	if(!dc.font.set)
+	if(dc.font.xfont)
 		XSetFont(dpy, dc.gc, dc.font.xfont->fid);
 	/* init bars */
 	updatebars();
 	updatestatus();
+	PHASE("bars");
 	/* EWMH support per view */
 	XChangeProperty(dpy, root, netatom[NetSupported], XA_ATOM, 32,
 			PropModeReplace, (unsigned char *) netatom, NetLast);
@@ -1748,48 +3838,152 @@ setup(void) {
 	                |PropertyChangeMask;
 	XChangeWindowAttributes(dpy, root, CWEventMask|CWCursor, &wa);
 	XSelectInput(dpy, root, wa.event_mask);
+#ifdef XRANDR
+	/* output changes which keep the root size send no ConfigureNotify */
+	if(XRRQueryExtension(dpy, &rrevent, &n))
+		XRRSelectInput(dpy, root, RRScreenChangeNotifyMask);
+	else
+		rrevent = -1;
+#endif /* XRANDR */
+	updatenumlockmask();
+	updatebuttongrabs();
 	grabkeys();
+	PHASE("grabs");
+	ipcsetup();
 }
 
 void
-showhide( Client *c ) {
-	if ( !c )
-		return;
-	if ( ISVISIBLE( c ) ) { /* show clients top down */
-		XMoveWindow( dpy, c->win, c->x, c->y );
-		if ( !( !c->isfloating && c->mon->views[ c->view ].lt->arrange ) )
+showhide( Monitor *m ) {
+	int i;
+	Client *c;
+
+	/* only the view shown before needs to be hidden, all of them if that
+	 * is unknown */
+	for ( i = 0 ; i < NUMVIEWS ; i++ )
+		if ( i != m->selview && ( m->shownview < 0 || i == m->shownview ) )
+			for ( c = m->views[ i ].stack ; c ; c = c->snext )
+				if ( !c->ishidden ) {
+					c->ishidden = True;
+					XMoveWindow( dpy, c->win, c->sentx = c->x + 2 * sw, c->senty = c->y );
+				}
+	m->shownview = m->selview;
+	for ( c = SELVIEW( m ).stack ; c ; c = c->snext ) { /* show clients top down */
+		if ( c->ishidden ) {
+			c->ishidden = False;
+			XMoveWindow( dpy, c->win, c->sentx = c->x, c->senty = c->y );
+		}
+		if ( !( !c->isfloating && SELVIEW( m ).lt->arrange ) )
 			resize( c, c->x, c->y, c->w, c->h, False );
-		showhide( c->snext );
-	}
-	else { /* hide clients bottom up */
-		showhide( c->snext );
-		XMoveWindow( dpy, c->win, c->x + 2 * sw, c->y );
 	}
 }
 
 
 void
 sigchld(int unused) {
-	if(signal(SIGCHLD, sigchld) == SIG_ERR)
-		die("Can't install SIGCHLD handler");
+	const int saved = errno;
+
 	while(0 < waitpid(-1, NULL, WNOHANG));
+	errno = saved;
+}
+
+#ifdef INSTRUMENT
+void
+sigusr1(int unused) {
+	dumpstats = 1; /* printed by run() after the current event batch */
+}
+
+StandIn *
+standin( Window traced ) {
+	unsigned int i;
+
+	for ( i = 0 ; i < nstandins ; i++ )
+		if ( standins[ i ].traced == traced )
+			return &standins[ i ];
+	return NULL;
 }
+#endif /* INSTRUMENT */
+
+#ifdef LOWMEM
+ClientSlab *
+slabof( Client *c ) {
+	ClientSlab *slab;
+
+	for ( slab = slabs ; !INSLAB( slab, c ) ; slab = slab->next );
+	return slab;
+}
+#endif /* LOWMEM */
 
 void
 spawn(const Arg *arg) {
+	char **const argv = (char **)arg->v;
+#ifdef POSIX_SPAWN_SETSID
+	extern char **environ;
+	posix_spawnattr_t attr;
+	pid_t pid;
+	int err;
+
+	/* no copy of our address space is made, the X connection is closed
+	 * on exec through FD_CLOEXEC */
+	if(!(err = posix_spawnattr_init(&attr))) {
+		if(!(err = posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID)))
+			err = posix_spawnp(&pid, argv[0], NULL, &attr, argv, environ);
+		posix_spawnattr_destroy(&attr);
+	}
+	if(err)
+		fprintf(stderr, "dwm: execvp %s failed: %s\n", argv[0], strerror(err));
+#else
+	/* the child has to call setsid() itself without POSIX_SPAWN_SETSID */
 	if(fork() == 0) {
-		if(dpy)
-			close(ConnectionNumber(dpy));
 		setsid();
-		execvp(((char **)arg->v)[0], (char **)arg->v);
-		fprintf(stderr, "dwm: execvp %s", ((char **)arg->v)[0]);
-		perror(" failed");
-		exit(0);
+		execvp(argv[0], argv);
+		fprintf(stderr, "dwm: execvp %s failed: %s\n", argv[0], strerror(errno));
+		_exit(EXIT_FAILURE);
 	}
+#endif /* POSIX_SPAWN_SETSID */
 }
 
+#ifdef XINERAMA
+void
+spliceview( Monitor *m, View *dst, View *src ) {
+	Client *c, *tail;
+
+	for ( c = src->clients ; c ; c = c->next )
+		c->mon = m;
+	/* append both lists as a whole, a head's prev is its tail */
+	if ( !dst->clients )
+		dst->clients = src->clients;
+	else if ( src->clients ) {
+		tail = src->clients->prev;
+		dst->clients->prev->next = src->clients;
+		src->clients->prev = dst->clients->prev;
+		dst->clients->prev = tail;
+	}
+	if ( !dst->stack )
+		dst->stack = src->stack;
+	else if ( src->stack ) {
+		tail = src->stack->sprev;
+		dst->stack->sprev->snext = src->stack;
+		src->stack->sprev = dst->stack->sprev;
+		dst->stack->sprev = tail;
+	}
+	dst->ntiled += src->ntiled;
+	dst->nfloating += src->nfloating;
+	dst->nurgent += src->nurgent;
+	if ( !dst->sel )
+		dst->sel = src->sel;
+	src->clients = src->stack = src->sel = NULL;
+	src->ntiled = src->nfloating = src->nurgent = 0;
+}
+#endif /* XINERAMA */
+
 int
-textnw(const char *text, unsigned int len) {
+textextents( const char *text, unsigned int len ) {
+#ifdef XFT
+	XGlyphInfo ext;
+
+	XftTextExtentsUtf8(dpy, dc.font.xft, (const FcChar8 *)text, len, &ext);
+	return ext.xOff;
+#else
 	XRectangle r;
 
 	if(dc.font.set) {
@@ -1797,81 +3991,130 @@ textnw(const char *text, unsigned int len) {
 		return r.width;
 	}
 	return XTextWidth(dc.font.xfont, text, len);
+#endif /* XFT */
 }
 
-void
-tile( Monitor *const m ) {
-	int x, y, h, rh, w, mw;
-	unsigned int nclient, nstack, nprocessed;
-	const unsigned int nmaster = SELVIEW( m ).nmaster;
-	Client *c;
-
-	// test amount of client window
-
-	for ( nclient = 0, c = nexttiled( SELVIEW( m ).clients ) ; c ; c = nexttiled( c->next ), nclient++ );
-	if ( nclient == 0 )
-		return;
-
-	// prepare common variables for later usage
-
-	c = nexttiled( SELVIEW( m ).clients );
-
-	if ( 0 < nmaster ) {
-		if ( nmaster < nclient ) {
-			mw = m->ww * SELVIEW( m ).mfact;
-		} else {
-			mw = m->ww;
+int
+textnw(const char *text, unsigned int len) {
+	unsigned int i;
+	TextWidth *tw, *lru;
+
+	if ( len >= sizeof( textcache[ 0 ].text ) )
+		return textextents( text, len );
+	for ( i = 0, lru = tw = textcache ; i < TEXTCACHESIZE ; i++, tw++ ) {
+		if ( tw->used && tw->len == len && !memcmp( tw->text, text, len ) ) {
+			tw->used = ++textclock;
+			return tw->width;
 		}
-	} else {
-		mw = 0;
+		if ( tw->used < lru->used )
+			lru = tw;
 	}
+	memcpy( lru->text, text, len );
+	lru->len = len;
+	lru->width = textextents( text, len );
+	lru->used = ++textclock;
+	return lru->width;
+}
 
-	// tile clients in master area
+void
+tally( Client *c, int d ) {
+	View *const v = &c->mon->views[ c->view ];
 
-	nprocessed = 0;
-	if ( nmaster ) {
-		x = m->wx;
-		y = m->wy;
-		w = mw;
-		h = ( nmaster <= nclient ) ? ( m->wh / nmaster ) : ( m->wh / nclient );
-		rh =( nmaster <= nclient ) ? ( m->wh % nmaster ) : ( m->wh % nclient );
+	if ( c->isfloating )
+		v->nfloating += d;
+	else
+		v->ntiled += d;
+	if ( c->isurgent )
+		v->nurgent += d;
+}
 
-		while ( NULL != c && nprocessed < nmaster ) {
-			resize( c, x, y,
-				w - 2 * c->bw,
-				h - 2 * c->bw + ( ( nprocessed < rh ) ? 1 : 0 ),
-				False
-			);
+void
+tile( const Tiling *t, Rect *r ) {
+	tilearea( t, r, False );
+}
 
-			y = c->y + HEIGHT( c );
-			c = nexttiled( c->next );
-			++nprocessed;
+void
+tilearea( const Tiling *t, Rect *r, Bool mirror ) {
+	const unsigned int nm = MIN( t->nmaster, t->n );
+	const TiledClient *tc;
+	unsigned int i, j, n = 0;
+	int mw, pos = 0, size = 0, rem = 0, swap, w, h;
+	Rect a = t->area;
+
+	/* master column on the left and stack column on the right, computed
+	 * on the transposed area for the mirrored variant */
+	if ( mirror ) {
+		swap = a.x; a.x = a.y; a.y = swap;
+		swap = a.w; a.w = a.h; a.h = swap;
+	}
+	mw = nm ? ( nm < t->n ? a.w * t->mfact : a.w ) : 0;
+	for ( i = 0 ; i < t->n ; i++ ) {
+		j = i < nm ? i : i - nm; /* position in the column */
+		if ( j == 0 ) {
+			n = i < nm ? nm : t->n - nm;
+			size = a.h / n;
+			rem = a.h % n;
+			pos = a.y;
+		}
+		r[ i ].x = i < nm ? a.x : a.x + mw;
+		r[ i ].w = i < nm ? mw : a.w - mw;
+		r[ i ].y = pos;
+		r[ i ].h = size + ( j < rem ? 1 : 0 );
+		if ( t->clients ) {
+			/* shrink to what applysizehints() leaves of the cell, the
+			 * next row starts below that and the slack collects at the
+			 * end of the column */
+			tc = &t->clients[ i ];
+			w = MAX( t->minsize, MAX( 1, ( mirror ? r[ i ].h : r[ i ].w ) - 2 * tc->bw ) );
+			h = MAX( t->minsize, MAX( 1, ( mirror ? r[ i ].w : r[ i ].h ) - 2 * tc->bw ) );
+			hintsize( &tc->hints, &w, &h );
+			r[ i ].w = ( mirror ? h : w ) + 2 * tc->bw;
+			r[ i ].h = ( mirror ? w : h ) + 2 * tc->bw;
+		}
+		pos += r[ i ].h;
+		if ( mirror ) {
+			swap = r[ i ].x; r[ i ].x = r[ i ].y; r[ i ].y = swap;
+			swap = r[ i ].w; r[ i ].w = r[ i ].h; r[ i ].h = swap;
 		}
 	}
+}
 
-	// tile clients in stacked area
+#ifdef INSTRUMENT
+void
+tracewrite( unsigned short type, const void *data, unsigned short len ) {
+	struct timespec now;
+	TraceRecord r;
+
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	r.delta = ( now.tv_sec - tracetime.tv_sec ) * 1000000 + ( now.tv_nsec - tracetime.tv_nsec ) / 1000;
+	tracetime = now;
+	r.type = type;
+	r.len = len;
+	if ( fwrite( &r, sizeof( r ), 1, trace ) != 1 || ( len && fwrite( data, len, 1, trace ) != 1 ) )
+		die( "dwm: cannot write trace: %s\n", strerror( errno ) );
+}
+#endif /* INSTRUMENT */
 
-	nstack = nclient - nprocessed;
-	nprocessed = 0;
-	if ( 0 < nstack ) {
-		x = m->wx + mw;
-		y = m->wy;
-		w = m->ww - mw;
-		h = m->wh / nstack;
-		rh = m->wh % nstack;
+#ifdef LOWMEM
+unsigned int
+titlebucket( const char *name ) {
+	unsigned int h;
 
-		while ( NULL != c ) {
-			resize( c, x, y,
-				w - 2 * c->bw,
-				h - 2 * c->bw + ( ( nprocessed < rh ) ? 1 : 0 ),
-				False
-			);
+	for ( h = 2166136261U ; *name ; name++ ) /* FNV-1a */
+		h = ( h ^ ( unsigned char ) *name ) * 16777619U;
+	return h % TITLEHASHSIZE;
+}
+#endif /* LOWMEM */
 
-			y = c->y + HEIGHT( c );
-			c = nexttiled( c->next );
-			++nprocessed;
-		}
-	}
+unsigned long
+truecolor( unsigned short v, unsigned long mask ) {
+	unsigned int shift = 0, bits = 0;
+
+	for ( ; mask && !( mask & 1 ) ; mask >>= 1 )
+		shift++;
+	for ( ; mask & 1 ; mask >>= 1 )
+		bits++;
+	return bits ? ( unsigned long ) ( v >> ( 16 - MIN( bits, 16 ) ) ) << shift : 0;
 }
 
 void
@@ -1887,7 +4130,7 @@ togglefloating( const Arg *arg ) {
 	Client *const c = SELVIEW( selmon ).sel;
 
 	if ( c ) {
-		c->isfloating = !c->isfloating || c->isfixed;
+		setfloating( c, !c->isfloating || c->isfixed );
 		if ( c->isfloating )
 			resize( c, c->x, c->y, c->w, c->h, False );
 		arrange( selmon );
@@ -1912,6 +4155,7 @@ unmanage( Client *c, Bool destroyed ) {
 	/* The server grab construct avoids race conditions. */
 	detach( c );
 	detachstack( c );
+	detachwin( c );
 	if ( !destroyed ) {
 		wc.border_width = c->oldbw;
 		XGrabServer( dpy );
@@ -1923,7 +4167,7 @@ unmanage( Client *c, Bool destroyed ) {
 		XSetErrorHandler( xerror );
 		XUngrabServer( dpy );
 	}
-	free( c );
+	freeclient( c );
 	focus( NULL );
 	arrange( m );
 }
@@ -1946,6 +4190,8 @@ updatebars(void) {
 	wa.background_pixmap = ParentRelative;
 	wa.event_mask = ButtonPressMask|ExposureMask;
 	for(m = mons; m; m = m->next) {
+		if(m->barwin) /* kept across geometry changes, moved by the caller */
+			continue;
 		m->barwin = XCreateWindow(dpy, root, m->wx, m->by, m->ww, bh, 0, DefaultDepth(dpy, screen),
 		                          CopyFromParent, DefaultVisual(dpy, screen),
 		                          CWOverrideRedirect|CWBackPixmap|CWEventMask, &wa);
@@ -1954,6 +4200,28 @@ updatebars(void) {
 	}
 }
 
+void
+updatedrawable( void ) {
+	int w = 0;
+	Monitor *m;
+
+	/* bars are drawn one after another, the widest one sets the size */
+	for ( m = mons ; m ; m = m->next )
+		w = MAX( w, m->ww );
+	if ( w == drawablew )
+		return;
+	if ( dc.drawable )
+		XFreePixmap( dpy, dc.drawable );
+	dc.drawable = XCreatePixmap( dpy, root, w, bh, DefaultDepth( dpy, screen ) );
+	drawablew = w;
+#ifdef XFT
+	if ( dc.xftdraw )
+		XftDrawChange( dc.xftdraw, dc.drawable );
+	else
+		dc.xftdraw = XftDrawCreate( dpy, dc.drawable, DefaultVisual( dpy, screen ), DefaultColormap( dpy, screen ) );
+#endif /* XFT */
+}
+
 void
 updatebarpos(Monitor *m) {
 	m->wy = m->my;
@@ -1974,13 +4242,10 @@ updategeom(void) {
 #ifdef XINERAMA
 	if ( XineramaIsActive( dpy ) ) {
 		int i, j, n, nn;
-		Client *c;
-		Monitor *m;
+		Monitor *m, *tail = NULL;
 		XineramaScreenInfo *info = XineramaQueryScreens( dpy, &nn );
 		XineramaScreenInfo *unique = NULL;
 
-		info = XineramaQueryScreens( dpy, &nn );
-		for ( n = 0, m = mons ; m ; m = m->next, n++ );
 		/* only consider unique geometries as separate screens */
 		if ( !( unique = ( XineramaScreenInfo * ) malloc( sizeof( XineramaScreenInfo ) * nn ) ) )
 			die( "fatal: could not malloc() %u bytes\n", sizeof( XineramaScreenInfo ) * nn );
@@ -1989,46 +4254,43 @@ updategeom(void) {
 				memcpy( &unique[ j++ ], &info[ i ], sizeof( XineramaScreenInfo ) );
 		XFree( info );
 		nn = j;
-		if ( n <= nn ) {
-			for ( i = 0 ; i < ( nn - n ) ; i++ ) { /* new monitors available */
-				for ( m = mons ; m && m->next ; m = m->next );
-				if ( m )
-					m->next = createmon();
-				else
-					mons = createmon();
-			}
-			for ( i = 0, m = mons ; i < nn && m ; m = m->next, i++ )
-				if ( n <= i
-					|| ( unique[ i ].x_org != m->mx || unique[ i ].y_org != m->my
-				    || unique[ i ].width != m->mw || unique[ i ].height != m->mh ) ) {
-					dirty = True;
-					m->num = i;
-					m->mx = m->wx = unique[ i ].x_org;
-					m->my = m->wy = unique[ i ].y_org;
-					m->mw = m->ww = unique[ i ].width;
-					m->mh = m->wh = unique[ i ].height;
-					updatebarpos( m );
-				}
+		for ( n = 0, m = mons ; m ; tail = m, m = m->next, n++ );
+		for ( i = n ; i < nn ; i++ ) { /* new monitors available */
+			m = createmon();
+			if ( tail )
+				tail->next = m;
+			else
+				mons = m;
+			tail = m;
 		}
-		else { /* less monitors available nn < n */
-			for ( i = nn ; i < n ; i++ ) {
-				for ( m = mons ; m && m->next ; m = m->next );
-				for ( j = 0 ; j < NUMVIEWS ; j++ ) {
-					while ( m->views[ j ].clients ) {
+		if ( 0 < nn && nn < n ) { /* less monitors available, the first one takes their clients */
+			for ( i = 1, tail = mons ; i < nn ; i++, tail = tail->next );
+			while ( ( m = tail->next ) ) {
+				for ( j = 0 ; j < NUMVIEWS ; j++ )
+					if ( m->views[ j ].clients ) {
 						dirty = True;
-						c = m->views[ j ].clients;
-						detach( c );
-						detachstack( c );
-						c->mon = mons;
-						attach( c );
-						attachstack( c );
+						spliceview( mons, &mons->views[ j ], &m->views[ j ] );
 					}
-				}
+				mons->dirty |= DirtyLayout;
+				mons->shownview = -1; /* the moved clients may be on any view */
 				if ( m == selmon )
 					selmon = mons;
 				cleanupmon( m );
 			}
 		}
+		for ( i = 0, m = mons ; i < nn && m ; m = m->next, i++ )
+			if ( n <= i
+				|| ( unique[ i ].x_org != m->mx || unique[ i ].y_org != m->my
+			    || unique[ i ].width != m->mw || unique[ i ].height != m->mh ) ) {
+				dirty = True;
+				m->dirty |= DirtyLayout;
+				m->num = i;
+				m->mx = m->wx = unique[ i ].x_org;
+				m->my = m->wy = unique[ i ].y_org;
+				m->mw = m->ww = unique[ i ].width;
+				m->mh = m->wh = unique[ i ].height;
+				updatebarpos( m );
+			}
 		free( unique );
 	}
 	else
@@ -2039,6 +4301,7 @@ updategeom(void) {
 			mons = createmon();
 		if ( mons->mw != sw || mons->mh != sh ) {
 			dirty = True;
+			mons->dirty |= DirtyLayout;
 			mons->mw = mons->ww = sw;
 			mons->mh = mons->wh = sh;
 			updatebarpos( mons );
@@ -2051,6 +4314,20 @@ updategeom(void) {
 	return dirty;
 }
 
+void
+updatebuttongrabs( void ) {
+	unsigned int i, j;
+	const unsigned int modifiers[] = { 0, LockMask, numlockmask, numlockmask | LockMask };
+
+	nclientbuttons = 0;
+	for ( i = 0 ; i < LENGTH( buttons ) ; i++ )
+		if ( buttons[ i ].click == ClkClientWin )
+			for ( j = 0 ; j < LENGTH( modifiers ) ; j++ ) {
+				clientbuttons[ nclientbuttons ].button = buttons[ i ].button;
+				clientbuttons[ nclientbuttons++ ].mask = buttons[ i ].mask | modifiers[ j ];
+			}
+}
+
 void
 updatenumlockmask(void) {
 	unsigned int i, j;
@@ -2066,6 +4343,21 @@ updatenumlockmask(void) {
 	XFreeModifiermap(modmap);
 }
 
+void
+updatescreen( int w, int h ) {
+	Monitor *m;
+
+	sw = w;
+	sh = h;
+	if ( updategeom() ) {
+		updatedrawable();
+		updatebars();
+		for ( m = mons ; m ; m = m->next )
+			XMoveResizeWindow( dpy, m->barwin, m->wx, m->by, m->ww, bh );
+		/* updategeom() marked the monitors which need to be arranged */
+	}
+}
+
 void
 updatesizehints(Client *c) {
 	long msize;
@@ -2075,60 +4367,63 @@ updatesizehints(Client *c) {
 		/* size is uninitialized, ensure that size.flags aren't used */
 		size.flags = PSize;
 	if(size.flags & PBaseSize) {
-		c->basew = size.base_width;
-		c->baseh = size.base_height;
+		c->hints.basew = size.base_width;
+		c->hints.baseh = size.base_height;
 	}
 	else if(size.flags & PMinSize) {
-		c->basew = size.min_width;
-		c->baseh = size.min_height;
+		c->hints.basew = size.min_width;
+		c->hints.baseh = size.min_height;
 	}
 	else
-		c->basew = c->baseh = 0;
+		c->hints.basew = c->hints.baseh = 0;
 	if(size.flags & PResizeInc) {
-		c->incw = size.width_inc;
-		c->inch = size.height_inc;
+		c->hints.incw = size.width_inc;
+		c->hints.inch = size.height_inc;
 	}
 	else
-		c->incw = c->inch = 0;
+		c->hints.incw = c->hints.inch = 0;
 	if(size.flags & PMaxSize) {
-		c->maxw = size.max_width;
-		c->maxh = size.max_height;
+		c->hints.maxw = size.max_width;
+		c->hints.maxh = size.max_height;
 	}
 	else
-		c->maxw = c->maxh = 0;
+		c->hints.maxw = c->hints.maxh = 0;
 	if(size.flags & PMinSize) {
-		c->minw = size.min_width;
-		c->minh = size.min_height;
+		c->hints.minw = size.min_width;
+		c->hints.minh = size.min_height;
 	}
 	else if(size.flags & PBaseSize) {
-		c->minw = size.base_width;
-		c->minh = size.base_height;
+		c->hints.minw = size.base_width;
+		c->hints.minh = size.base_height;
 	}
 	else
-		c->minw = c->minh = 0;
+		c->hints.minw = c->hints.minh = 0;
 	if(size.flags & PAspect) {
-		c->mina = (float)size.min_aspect.y / size.min_aspect.x;
-		c->maxa = (float)size.max_aspect.x / size.max_aspect.y;
+		c->hints.mina = (float)size.min_aspect.y / size.min_aspect.x;
+		c->hints.maxa = (float)size.max_aspect.x / size.max_aspect.y;
 	}
 	else
-		c->maxa = c->mina = 0.0;
-	c->isfixed = (c->maxw && c->minw && c->maxh && c->minh
-	             && c->maxw == c->minw && c->maxh == c->minh);
+		c->hints.maxa = c->hints.mina = 0.0;
+	c->isfixed = (c->hints.maxw && c->hints.minw && c->hints.maxh && c->hints.minh
+	             && c->hints.maxw == c->hints.minw && c->hints.maxh == c->hints.minh);
 }
 
 void
 updatetitle(Client *c) {
-	if(!gettextprop(c->win, netatom[NetWMName], c->name, sizeof( c->name )))
-		gettextprop(c->win, XA_WM_NAME, c->name, sizeof( c->name ));
-	if(c->name[0] == '\0') /* hack to mark broken clients */
-		strcpy(c->name, broken);
+	char name[256];
+
+	if(!gettextprop(c->win, netatom[NetWMName], name, sizeof name))
+		gettextprop(c->win, XA_WM_NAME, name, sizeof name);
+	setname(c, name[0] ? name : broken); /* hack to mark broken clients */
+	c->titlestale = False;
 }
 
 void
 updatestatus(void) {
 	if ( !gettextprop( root, XA_WM_NAME, stext, sizeof( stext ) ) )
 		strcpy( stext, "myDWM-"VERSION );
-	drawbar( selmon );
+	laststatus = monotonic();
+	selmon->dirty |= DirtyBar;
 }
 
 void
@@ -2141,7 +4436,7 @@ updatewmhints( Client *c ) {
 			XSetWMHints( dpy, c->win, wmh );
 		}
 		else
-			c->isurgent = ( wmh->flags & XUrgencyHint ) ? True : False;
+			seturgent( c, ( wmh->flags & XUrgencyHint ) ? True : False );
 		XFree( wmh );
 	}
 }
@@ -2157,14 +4452,10 @@ view(const Arg *arg) {
 Client *
 wintoclient( Window w ) {
 	Client *c;
-	const Monitor *m;
-	int i;
 
-	for ( m = mons ; m ; m = m->next )
-		for ( i = 0 ; i < NUMVIEWS ; i++ )
-			for ( c = m->views[ i ].clients ; c ; c = c->next )
-				if ( w == c->win )
-					return c;
+	for ( c = wintable[ WINHASH( w ) ] ; c ; c = c->hnext )
+		if ( w == c->win )
+			return c;
 	return NULL;
 }
 
@@ -2176,11 +4467,11 @@ wintomon(Window w) {
 
 	if(w == root && getrootptr(&x, &y))
 		return ptrtomon(x, y);
+	if((c = wintoclient(w)))
+		return c->mon;
 	for(m = mons; m; m = m->next)
 		if(w == m->barwin)
 			return m;
-	if((c = wintoclient(w)))
-		return c->mon;
 	return selmon;
 }
 
@@ -2217,6 +4508,14 @@ xerrorstart(Display *dpy, XErrorEvent *ee) {
 	return -1;
 }
 
+#ifdef XFT
+void
+xftcolor( const char *colstr, XftColor *color ) {
+	if ( !XftColorAllocName( dpy, DefaultVisual( dpy, screen ), DefaultColormap( dpy, screen ), colstr, color ) )
+		die( "error, cannot allocate color '%s'\n", colstr );
+}
+#endif /* XFT */
+
 void
 zoom( const Arg *arg ) {
 	Client *c;
@@ -2238,19 +4537,66 @@ zoom( const Arg *arg ) {
 
 int
 main(int argc, char *argv[]) {
+#ifdef INSTRUMENT
+	const char *replayfile = NULL;
+
+	if(argc == 3 && !strcmp("-r", argv[1])) {
+		if(!(trace = fopen(argv[2], "wb")) || fputs(TRACEMAGIC, trace) == EOF)
+			die("dwm: cannot create trace %s: %s\n", argv[2], strerror(errno));
+		clock_gettime(CLOCK_MONOTONIC, &tracetime);
+		argc = 1;
+	}
+	else if(argc == 3 && !strcmp("-p", argv[1])) {
+		replayfile = argv[2];
+		argc = 1;
+	}
+	else if(argc != 1 && !(argc == 2 && !strcmp("-v", argv[1])))
+		die("usage: dwm [-v] [-r trace | -p trace]\n");
+#endif /* INSTRUMENT */
 	if(argc == 2 && !strcmp("-v", argv[1]))
 		die("dwm-"VERSION", © 2006-2011 dwm engineers, see LICENSE for details\n");
 	else if(argc != 1)
 		die("usage: dwm [-v]\n");
 	if(!setlocale(LC_CTYPE, "") || !XSupportsLocale())
 		fputs("warning: no locale support\n", stderr);
+	PHASE(NULL);
 	if(!(dpy = XOpenDisplay(NULL)))
 		die("dwm: cannot open display\n");
 	checkotherwm();
+	PHASE("connect");
 	setup();
+#ifdef INSTRUMENT
+	if(trace)
+		recordstart();
+#endif /* INSTRUMENT */
 	scan();
+	PHASE("scan");
+#ifdef INSTRUMENT
+	if(replayfile)
+		replay(replayfile);
+	else
+#endif /* INSTRUMENT */
 	run();
+	if(restarting) {
+		/* the server keeps the client windows, hand over how they were managed */
+		savestate();
+		ipccleanup();
+#ifdef INSTRUMENT
+		if(trace)
+			fclose(trace);
+#endif /* INSTRUMENT */
+		XCloseDisplay(dpy);
+		/* argc is 1 after option parsing, -r and -p are not passed on,
+		 * the next dwm would truncate the trace recorded so far */
+		argv[argc] = NULL;
+		execvp(argv[0], argv);
+		die("dwm: execvp %s failed: %s\n", argv[0], strerror(errno));
+	}
 	cleanup();
+#ifdef INSTRUMENT
+	if(trace)
+		fclose(trace);
+#endif /* INSTRUMENT */
 	XCloseDisplay(dpy);
 	return 0;
 }
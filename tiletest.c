@@ -0,0 +1,189 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * tiletest checks the rectangles the tiling layouts compute and times them.
+ * Layouts are pure functions from a Tiling to one Rect per tiled client, so
+ * they are called directly, without a display. dwm.c is included to reach
+ * its static functions.
+ */
+#define main dwmmain
+#include "dwm.c"
+#undef main
+
+#define ITERATIONS              1000000
+
+/* function declarations */
+static void check(const char *what, Bool ok);
+static void checkcolumns(const char *what, const Tiling *t, const Rect *r, Bool mirror);
+static void hinted(void);
+static void leftover(void);
+static void mirrored(void);
+static void nomaster(void);
+static void onlymaster(void);
+static Tiling tiling(int w, int h, unsigned int n, unsigned int nmaster, float mfact);
+static void timing(void);
+
+/* variables */
+static char symbol[16];
+static unsigned int failures = 0;
+
+/* function implementations */
+void
+check(const char *what, Bool ok) {
+	if(!ok) {
+		fprintf(stderr, "tiletest: %s failed\n", what);
+		failures++;
+	}
+}
+
+void
+checkcolumns(const char *what, const Tiling *t, const Rect *r, Bool mirror) {
+	unsigned int i;
+	int x, y, w, h, pos = 0, len;
+
+	/* every column is filled gap free from the top, in client order */
+	for(i = 0; i < t->n; i++) {
+		x = mirror ? r[i].y - t->area.y : r[i].x - t->area.x;
+		y = mirror ? r[i].x - t->area.x : r[i].y - t->area.y;
+		w = mirror ? r[i].h : r[i].w;
+		h = mirror ? r[i].w : r[i].h;
+		len = mirror ? t->area.w : t->area.h;
+		if(i == 0 || i == MIN(t->nmaster, t->n))
+			pos = 0;
+		check(what, y == pos && h > 0 && w > 0 && x >= 0
+		      && x + w <= (mirror ? t->area.h : t->area.w));
+		pos += h;
+		if(i + 1 == t->n || i + 1 == MIN(t->nmaster, t->n))
+			check(what, pos == len);
+	}
+}
+
+void
+hinted(void) {
+	Tiling t = tiling(800, 600, 3, 0, 0.5), tm = tiling(600, 800, 3, 0, 0.5);
+	TiledClient tc[3];
+	Rect r[3];
+	unsigned int i;
+
+	/* rows shrunk by their increments are packed, the slack is left at
+	 * the end of the column as resize() applies the same hints */
+	memset(tc, 0, sizeof(tc));
+	for(i = 0; i < 3; i++) {
+		tc[i].bw = 1;
+		tc[i].hints.inch = tc[i].hints.incw = 50;
+	}
+	t.clients = tm.clients = tc;
+	tile(&t, r);
+	for(i = 0; i < 3; i++)
+		check("hinted rows", r[i].x == 0 && r[i].y == 152 * i && r[i].w == 752 && r[i].h == 152);
+	mirrortile(&tm, r);
+	for(i = 0; i < 3; i++)
+		check("hinted columns", r[i].y == 0 && r[i].x == 152 * i && r[i].h == 752 && r[i].w == 152);
+}
+
+void
+leftover(void) {
+	Tiling t = tiling(1000, 100, 4, 1, 0.5);
+	Rect r[4];
+
+	/* 100 pixels over 3 stack rows, the first rows get one more */
+	tile(&t, r);
+	checkcolumns("leftover", &t, r, False);
+	check("leftover heights", r[1].h == 34 && r[2].h == 33 && r[3].h == 33);
+	check("leftover master", r[0].w == 500 && r[0].h == 100);
+	check("leftover stack", r[1].x == 500 && r[1].w == 500);
+}
+
+void
+mirrored(void) {
+	Tiling t = tiling(601, 400, 5, 2, 0.3), tt = tiling(400, 601, 5, 2, 0.3);
+	Rect r[5], rt[5];
+	unsigned int i;
+
+	/* the mirrored layout is tile on the transposed area, transposed */
+	mirrortile(&t, r);
+	tile(&tt, rt);
+	checkcolumns("mirrored", &t, r, True);
+	for(i = 0; i < 5; i++)
+		check("mirrored transpose", r[i].x == rt[i].y && r[i].y == rt[i].x
+		      && r[i].w == rt[i].h && r[i].h == rt[i].w);
+	check("mirrored master", r[0].y == 0 && r[0].h == 120 && r[2].y == 120 && r[2].h == 280);
+}
+
+void
+nomaster(void) {
+	Tiling t = tiling(800, 600, 3, 0, 0.5);
+	Rect r[3];
+	unsigned int i;
+
+	tile(&t, r);
+	checkcolumns("nmaster 0", &t, r, False);
+	for(i = 0; i < 3; i++)
+		check("nmaster 0 width", r[i].x == 0 && r[i].w == 800);
+}
+
+void
+onlymaster(void) {
+	Tiling t = tiling(800, 600, 3, 5, 0.5);
+	Rect r[3];
+	unsigned int i;
+
+	tile(&t, r);
+	checkcolumns("nmaster >= n", &t, r, False);
+	for(i = 0; i < 3; i++)
+		check("nmaster >= n width", r[i].x == 0 && r[i].w == 800);
+	t.nmaster = 3;
+	tile(&t, r);
+	check("nmaster == n width", r[2].w == 800 && r[2].h == 200);
+}
+
+Tiling
+tiling(int w, int h, unsigned int n, unsigned int nmaster, float mfact) {
+	Tiling t;
+
+	t.area.x = t.area.y = 0;
+	t.area.w = w;
+	t.area.h = h;
+	t.n = t.nall = n;
+	t.nmaster = nmaster;
+	t.mfact = mfact;
+	t.symbol = symbol;
+	t.symbolsize = sizeof(symbol);
+	t.clients = NULL;
+	t.minsize = 0;
+	return t;
+}
+
+void
+timing(void) {
+	static Rect r[32];
+	const Layout lts[] = { { "tile", tile }, { "mirrortile", mirrortile } };
+	Tiling t = tiling(1920, 1080, 32, 2, 0.55);
+	struct timespec start, end;
+	unsigned int i, l;
+	volatile int sink = 0;
+
+	for(l = 0; l < LENGTH(lts); l++) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for(i = 0; i < ITERATIONS; i++) {
+			t.n = 1 + i % 32;
+			lts[l].arrange(&t, r);
+			sink += r[t.n - 1].h;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		printf("tiletest: %-10s %8u calls %8.1f ns per call, 1 to 32 clients\n", lts[l].symbol, ITERATIONS,
+		       ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / ITERATIONS);
+	}
+}
+
+int
+main(void) {
+	nomaster();
+	onlymaster();
+	leftover();
+	mirrored();
+	hinted();
+	if(failures)
+		die("tiletest: %u checks failed\n", failures);
+	timing();
+	return 0;
+}
@@ -0,0 +1,237 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * xstorm is a synthetic X client used by bench.sh to put load on a running
+ * window manager. Each scenario floods the WM with one kind of request and
+ * reports the wall time until the WM has worked through all of it.
+ *
+ * Completion is detected with a sentinel: a window is mapped after the burst
+ * and its MapNotify only arrives once the WM handled the MapRequest, which it
+ * reads after every event generated by the burst.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <X11/keysym.h>
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XTest.h>
+
+/* macros */
+#define LENGTH(X)               ( sizeof( X ) / sizeof( X[ 0 ] ) )
+
+typedef struct {
+	const char *name;
+	void (*run)(unsigned int n);
+	unsigned int n;          /* default iterations */
+} Scenario;
+
+/* function declarations */
+static Window createwin(void);
+static void die(const char *errstr, ...);
+static void drag(unsigned int n);
+static void hotplug(unsigned int n);
+static void map(unsigned int n);
+static double now(void);
+static void settle(void);
+static void status(unsigned int n);
+static void title(unsigned int n);
+static void view(unsigned int n);
+static void waitfor(Window w, int type);
+
+/* variables */
+static Display *dpy;
+static Window root;
+static int screen;
+static const Scenario scenarios[] = {
+	/* name         function    iterations */
+	{ "map",        map,        500 },
+	{ "view",       view,       900 },
+	{ "title",      title,      2000 },
+	{ "status",     status,     2000 },
+	{ "drag",       drag,       2000 },
+	{ "hotplug",    hotplug,    50 },
+};
+
+/* function implementations */
+Window
+createwin(void) {
+	Window w;
+
+	w = XCreateSimpleWindow(dpy, root, 0, 0, 200, 100, 0, 0, WhitePixel(dpy, screen));
+	XSelectInput(dpy, w, StructureNotifyMask);
+	return w;
+}
+
+void
+die(const char *errstr, ...) {
+	va_list ap;
+
+	va_start(ap, errstr);
+	vfprintf(stderr, errstr, ap);
+	va_end(ap);
+	exit(EXIT_FAILURE);
+}
+
+void
+drag(unsigned int n) {
+	unsigned int i;
+	KeyCode mod = XKeysymToKeycode(dpy, XK_Super_L);
+	Window w = createwin();
+
+	XMapWindow(dpy, w);
+	waitfor(w, MapNotify);
+	XTestFakeMotionEvent(dpy, screen, DisplayWidth(dpy, screen) / 2, DisplayHeight(dpy, screen) / 2, 0);
+	XTestFakeKeyEvent(dpy, mod, True, 0);
+	XTestFakeButtonEvent(dpy, Button1, True, 0);
+	for(i = 0; i < n; i++) /* pointer trace over a 1000 Hz mouse */
+		XTestFakeMotionEvent(dpy, screen, 100 + i % 400, 100 + (i / 2) % 300, 1);
+	XTestFakeButtonEvent(dpy, Button1, False, 0);
+	XTestFakeKeyEvent(dpy, mod, False, 0);
+	settle();
+	XDestroyWindow(dpy, w);
+}
+
+void
+hotplug(unsigned int n) {
+	unsigned int i;
+	XEvent ev;
+
+	/* dwm reacts to root ConfigureNotify with updategeom() */
+	memset(&ev, 0, sizeof(ev));
+	ev.xconfigure.type = ConfigureNotify;
+	ev.xconfigure.event = ev.xconfigure.window = root;
+	for(i = 0; i <= n; i++) { /* the last one restores the real size */
+		ev.xconfigure.width = DisplayWidth(dpy, screen) - (i % 2 && i < n ? 100 : 0);
+		ev.xconfigure.height = DisplayHeight(dpy, screen) - (i % 2 && i < n ? 100 : 0);
+		XSendEvent(dpy, root, False, StructureNotifyMask, &ev);
+	}
+	settle();
+}
+
+void
+map(unsigned int n) {
+	unsigned int i;
+	Window *wins;
+
+	if(!(wins = malloc(n * sizeof(Window))))
+		die("fatal: could not malloc() %u bytes\n", n * sizeof(Window));
+	for(i = 0; i < n; i++) {
+		wins[i] = createwin();
+		XMapWindow(dpy, wins[i]);
+	}
+	for(i = 0; i < n; i++)
+		waitfor(wins[i], MapNotify);
+	for(i = 0; i < n; i++)
+		XDestroyWindow(dpy, wins[i]);
+	settle();
+	free(wins);
+}
+
+double
+now(void) {
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1000.0 + t.tv_nsec / 1000000.0;
+}
+
+void
+settle(void) {
+	Window w = createwin();
+
+	XMapWindow(dpy, w);
+	waitfor(w, MapNotify);
+	XDestroyWindow(dpy, w);
+	XSync(dpy, False);
+}
+
+void
+status(unsigned int n) {
+	unsigned int i;
+	char buf[64];
+
+	for(i = 0; i < n; i++) {
+		snprintf(buf, sizeof(buf), "xstorm status %u", i);
+		XStoreName(dpy, root, buf);
+	}
+	settle();
+}
+
+void
+title(unsigned int n) {
+	unsigned int i;
+	char buf[64];
+	Window w = createwin();
+
+	XMapWindow(dpy, w);
+	waitfor(w, MapNotify);
+	for(i = 0; i < n; i++) {
+		snprintf(buf, sizeof(buf), "xstorm title %u%%", i % 101);
+		XStoreName(dpy, w, buf);
+	}
+	settle();
+	XDestroyWindow(dpy, w);
+}
+
+void
+view(unsigned int n) {
+	unsigned int i;
+	KeyCode mod = XKeysymToKeycode(dpy, XK_Super_L);
+	KeyCode code;
+	Window wins[9];
+
+	for(i = 0; i < LENGTH(wins); i++) { /* put something on every view */
+		wins[i] = createwin();
+		XMapWindow(dpy, wins[i]);
+		waitfor(wins[i], MapNotify);
+		code = XKeysymToKeycode(dpy, XK_1 + (i + 1) % 9);
+		XTestFakeKeyEvent(dpy, mod, True, 0);
+		XTestFakeKeyEvent(dpy, code, True, 0);
+		XTestFakeKeyEvent(dpy, code, False, 0);
+		XTestFakeKeyEvent(dpy, mod, False, 0);
+	}
+	XTestFakeKeyEvent(dpy, mod, True, 0);
+	for(i = 0; i < n; i++) {
+		code = XKeysymToKeycode(dpy, XK_1 + i % 9);
+		XTestFakeKeyEvent(dpy, code, True, 0);
+		XTestFakeKeyEvent(dpy, code, False, 0);
+	}
+	XTestFakeKeyEvent(dpy, mod, False, 0);
+	settle();
+	for(i = 0; i < LENGTH(wins); i++)
+		XDestroyWindow(dpy, wins[i]);
+}
+
+void
+waitfor(Window w, int type) {
+	XEvent ev;
+
+	do
+		XWindowEvent(dpy, w, StructureNotifyMask, &ev);
+	while(ev.type != type);
+}
+
+int
+main(int argc, char *argv[]) {
+	unsigned int i, n;
+	double t;
+
+	if(argc < 2 || argc > 3)
+		die("usage: xstorm scenario [iterations]\n");
+	for(i = 0; i < LENGTH(scenarios) && strcmp(scenarios[i].name, argv[1]); i++);
+	if(i == LENGTH(scenarios))
+		die("xstorm: unknown scenario '%s'\n", argv[1]);
+	n = argc == 3 ? atoi(argv[2]) : scenarios[i].n;
+	if(!(dpy = XOpenDisplay(NULL)))
+		die("xstorm: cannot open display\n");
+	screen = DefaultScreen(dpy);
+	root = RootWindow(dpy, screen);
+	t = now();
+	scenarios[i].run(n);
+	printf("xstorm: %-8s %6u iterations %10.1f ms\n", scenarios[i].name, n, now() - t);
+	XCloseDisplay(dpy);
+	return 0;
+}